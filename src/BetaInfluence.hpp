@@ -37,7 +37,6 @@ class BetaInfluence: public InfluenceDistribution {
   double alpha_, beta_;
   double quartile_med_;
   double quartile_upper_;
-  double quartile_stdev_;
   double original_mean_;
   std::default_random_engine gen_;
 
@@ -67,40 +66,71 @@ class BetaInfluence: public InfluenceDistribution {
   double mean() { return (double)alpha_ / (double)(alpha_ + beta_); }
 
   double sample(unsigned int interval) {
+    return sample_interval(alpha_, beta_, quartile_upper_, round_, interval,
+                           gen_);
+  }
+
+  double sq_error() {
+    return (quartile_med_ - original_mean_) * (quartile_med_ - original_mean_);
+  }
+
+  double get_alpha() const { return alpha_; }
+
+  double get_beta() const { return beta_; }
+
+  double get_upper_quartile() const { return quartile_upper_; }
+
+  double get_original_mean() const { return original_mean_; }
+
+  double get_round() const { return round_; }
+
+  /**
+    Value of the influence for a given `interval` (INFLUENCE_MED, ...) of a Beta
+    distribution of parameters `alpha` and `beta`, whose upper quartile is
+    `upper`. It is also used by EdgeParameters, which stores these parameters
+    in flat arrays. Thompson samples are drawn with `gen` (a standard random
+    engine, or the generators of Sampler.hpp).
+  */
+  template<typename Gen>
+  static double sample_interval(double alpha, double beta, double upper,
+                                double round, unsigned int interval,
+                                Gen& gen) {
+    double med = alpha / (alpha + beta);
     if (interval == INFLUENCE_MED) {
-      return quartile_med_;
+      return med;
     } else if (interval == INFLUENCE_UPPER) {
-      return quartile_upper_;
+      return upper;
     } else if(interval == INFLUENCE_UCB) {
-      double val = quartile_med_ + sqrt(3.0 * log(round_) /
-          (2.0 * (alpha_ + beta_)));
+      double val = med + sqrt(3.0 * log(round) / (2.0 * (alpha + beta)));
       return (val < 1) ? val : 1.0;
     } else if (interval == INFLUENCE_THOMPSON) {
-      std::gamma_distribution<double> a(alpha_, 1.0);
-      std::gamma_distribution<double> b(beta_, 1.0);
-      double x = a(gen_);
-      double y = b(gen_);
+      std::gamma_distribution<double> a(alpha, 1.0);
+      std::gamma_distribution<double> b(beta, 1.0);
+      double x = a(gen);
+      double y = b(gen);
       return x / (x + y);
     } else { // Case where we shift the distributions by theta stdev (EG)
-      double val = quartile_med_ + (interval - (double)THETA_OFFSET - 1.0)
-          * quartile_stdev_;
+      double stdev = sqrt(alpha * beta / (alpha + beta + 1.0))
+          / (alpha + beta);
+      double val = med + (interval - (double)THETA_OFFSET - 1.0) * stdev;
       val = val < 1 ? val : 1.0;
       return val > 0 ? val : 0.0;
     }
-    return quartile_med_;
+    return med;
   }
 
-  double sq_error() {
-    return (quartile_med_ - original_mean_) * (quartile_med_ - original_mean_);
+  /**
+    Upper quartile of a Beta distribution of parameters `alpha` and `beta`.
+  */
+  static double upper_quartile(double alpha, double beta) {
+    boost::math::beta_distribution<> dist(alpha, beta);
+    return quantile(dist, 0.75);
   }
 
  private:
   void update_quartiles() {
-    boost::math::beta_distribution<> dist(alpha_, beta_);
     quartile_med_ = alpha_ / (alpha_ + beta_);
-    quartile_stdev_ = sqrt(alpha_ * beta_ / (alpha_ + beta_ + 1.0))
-        / (alpha_ + beta_);
-    quartile_upper_ = quantile(dist, 0.75);
+    quartile_upper_ = upper_quartile(alpha_, beta_);
   }
 };
 
@@ -27,6 +27,7 @@
 
 #include "common.hpp"
 #include "Evaluator.hpp"
+#include "SnapshotStore.hpp"
 
 class CELFEvaluator : public Evaluator {
  private:
@@ -37,10 +38,41 @@ class CELFEvaluator : public Evaluator {
       return (spr < a.spr) ? true : ((spr > a.spr) ? false : id > a.id);
     }
   };
-  unsigned int samples_;
+  unsigned int samples_;  // Samples per spread (at most, if `rel_error_`)
+  double rel_error_;
+  double confidence_;
+  std::shared_ptr<SnapshotStore> snapshots_;  // nullptr if sampling spreads
+  bool use_snapshots_ = false;  // Whether the current selection uses them
+
+  /**
+    Spread of `seeds`, on the snapshots if used, otherwise with `samples_`
+    samples, or fewer when the relative error `rel_error_` is reached (see
+    `Sampler::sample_adaptive`).
+  */
+  double spread(const Graph& graph, Sampler& sampler,
+                const std::unordered_set<unode_int>& activated,
+                const std::unordered_set<unode_int>& seeds) {
+    if (use_snapshots_)
+      return snapshots_->spread(graph, sampler.get_type(), activated, seeds);
+    if (rel_error_ > 0)
+      return sampler.sample_adaptive(graph, activated, seeds, samples_,
+                                     rel_error_, confidence_);
+    return sampler.sample(graph, activated, seeds, samples_);
+  }
 
  public:
-  CELFEvaluator(unsigned int samples) : samples_(samples) {}
+  CELFEvaluator(unsigned int samples, double rel_error=0,
+                double confidence=0.95)
+      : samples_(samples), rel_error_(rel_error), confidence_(confidence) {}
+
+  /**
+    CELF on the snapshots of `snapshots` (StaticGreedy), which may be shared
+    with other evaluators. Spreads are still sampled for influences drawn
+    from the posteriors, which no snapshot can be kept for.
+  */
+  CELFEvaluator(std::shared_ptr<SnapshotStore> snapshots)
+      : samples_(snapshots->size()), rel_error_(0), confidence_(0.95),
+        snapshots_(snapshots) {}
 
   std::unordered_set<unode_int> select(
       const Graph& graph, Sampler& sampler,
@@ -49,6 +81,10 @@ class CELFEvaluator : public Evaluator {
     std::unordered_map<unode_int,
       boost::heap::fibonacci_heap<celf_node_type>::handle_type> queue_nodes;
     std::unordered_set<unode_int> set;
+    use_snapshots_ = snapshots_ &&
+        graph.get_edge_parameters().is_deterministic(sampler.get_type());
+    if (use_snapshots_)
+      snapshots_->get(graph, sampler.get_type());
 
     // Initial loop
     for (unode_int node : graph.get_nodes()) {
@@ -56,7 +92,7 @@ class CELFEvaluator : public Evaluator {
       u.id = node;
       std::unordered_set<unode_int> seeds;
       seeds.insert(node);
-      u.spr = sampler.sample(graph, activated, seeds, samples_);
+      u.spr = spread(graph, sampler, activated, seeds);
       queue_nodes[node] = queue.push(u);
     }
 
@@ -72,7 +108,7 @@ class CELFEvaluator : public Evaluator {
         for (unode_int node : set) seeds.insert(node);
         seeds.insert(u.id);
         double prev_val = u.spr;
-        u.spr = sampler.sample(graph, activated, seeds, samples_) - prev_val;
+        u.spr = spread(graph, sampler, activated, seeds) - prev_val;
         if (u.spr >= queue.top().spr) {
           set.insert(u.id);
           found = true;
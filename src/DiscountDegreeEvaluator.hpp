@@ -43,9 +43,9 @@ class DiscountDegreeEvaluator : public Evaluator {
         nstruct.id = node;
         nstruct.deg = activated.find(node) == activated.end() ? 1.0f : 0.0f;
         if (graph.has_neighbours(node)) {
-          for (auto edge : graph.get_neighbours(node)) {
+          for (auto& edge : graph.get_neighbours(node)) {
             if(activated.find(edge.target) == activated.end()) {
-              nstruct.deg += edge.dist->sample(type);
+              nstruct.deg += graph.get_influence(edge, type);
             }
           }
         }
@@ -54,12 +54,12 @@ class DiscountDegreeEvaluator : public Evaluator {
     while (set.size() < k && (!queue.empty())) {
       NodeType nstruct = queue.top();
       set.insert(nstruct.id);
-      for (auto edge : graph.get_neighbours(nstruct.id)) {
+      for (auto& edge : graph.get_neighbours(nstruct.id)) {
         if (activated.find(edge.target) == activated.end() &&
             set.find(edge.target) == set.end()) {
           NodeType newnstruct = *queue_nodes[edge.target];
           newnstruct.id = edge.target;
-          newnstruct.deg = newnstruct.deg*(1.0f - edge.dist->sample(type));
+          newnstruct.deg = newnstruct.deg*(1.0f - graph.get_influence(edge, type));
           queue.update(queue_nodes[edge.target], newnstruct);
         }
       }
@@ -0,0 +1,153 @@
+/*
+ Copyright (c) 2015-2017 Paul Lagrée, Siyu Lei, Silviu Maniu, Luyi Mo
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#ifndef __oim__EdgeListParser__
+#define __oim__EdgeListParser__
+
+#include <vector>
+#include <string>
+#include <charconv>
+#include <cstring>
+
+#include "common.hpp"
+#include "FlatArray.hpp"
+
+/**
+  Edges read in a text graph file, in the order of the file.
+*/
+struct EdgeList {
+  std::vector<unode_int> sources;
+  std::vector<unode_int> targets;
+  std::vector<double> probs;
+
+  size_t size() const { return sources.size(); }
+};
+
+/**
+  Parser of graph files made of lines `node1 <TAB> node2 <TAB> prob`. The file
+  is memory-mapped and split in line-aligned chunks that are parsed in parallel
+  (with std::from_chars, which ignores the locale). Empty lines are skipped,
+  any other malformed line is an error.
+*/
+class EdgeListParser {
+ private:
+  unsigned int n_threads_;
+
+ public:
+  EdgeListParser(unsigned int n_threads = hardware_threads())
+      : n_threads_(n_threads > 0 ? n_threads : 1) {}
+
+  EdgeList parse(const std::string& filename) const {
+    MappedFile file(filename);
+    const char* data = file.data();
+    size_t size = file.size();
+    // Chunk t is [bounds[t], bounds[t + 1]), each bound is a start of line
+    std::vector<size_t> bounds(n_threads_ + 1, size);
+    bounds[0] = 0;
+    for (unsigned int t = 1; t < n_threads_; t++) {
+      size_t pos = std::max(size * t / n_threads_, bounds[t - 1]);
+      while (pos > 0 && pos < size && data[pos - 1] != '\n')
+        pos++;
+      bounds[t] = pos;
+    }
+    std::vector<EdgeList> chunks(n_threads_);
+    std::vector<bool> failed(n_threads_, false);
+    parallel_chunks(n_threads_, n_threads_,
+        [&](unsigned int t, size_t, size_t) {
+          failed[t] = !parse_chunk(data + bounds[t], data + bounds[t + 1],
+                                   chunks[t]);
+        });
+    for (unsigned int t = 0; t < n_threads_; t++) {
+      if (failed[t]) {
+        std::cerr << "Error: malformed line in " << filename << std::endl;
+        exit(1);
+      }
+    }
+    // Concatenates the chunks, each thread copying its own
+    std::vector<size_t> starts(n_threads_ + 1, 0);
+    for (unsigned int t = 0; t < n_threads_; t++)
+      starts[t + 1] = starts[t] + chunks[t].size();
+    EdgeList edges;
+    edges.sources.resize(starts[n_threads_]);
+    edges.targets.resize(starts[n_threads_]);
+    edges.probs.resize(starts[n_threads_]);
+    parallel_chunks(n_threads_, n_threads_,
+        [&](unsigned int t, size_t, size_t) {
+          EdgeList& chunk = chunks[t];
+          std::copy(chunk.sources.begin(), chunk.sources.end(),
+                    edges.sources.begin() + starts[t]);
+          std::copy(chunk.targets.begin(), chunk.targets.end(),
+                    edges.targets.begin() + starts[t]);
+          std::copy(chunk.probs.begin(), chunk.probs.end(),
+                    edges.probs.begin() + starts[t]);
+          chunk = EdgeList();
+        });
+    return edges;
+  }
+
+ private:
+  static const char* skip_blanks(const char* pos, const char* end) {
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+      pos++;
+    return pos;
+  }
+
+  /**
+    Parses the lines in [pos, end) into `edges`, returns false on a malformed
+    line.
+  */
+  static bool parse_chunk(const char* pos, const char* end, EdgeList& edges) {
+    edges.sources.reserve((end - pos) / 16);
+    edges.targets.reserve((end - pos) / 16);
+    edges.probs.reserve((end - pos) / 16);
+    while (pos < end) {
+      pos = skip_blanks(pos, end);
+      if (pos < end && *pos == '\n') {
+        pos++;
+        continue;
+      }
+      if (pos == end)
+        break;
+      unode_int src, tgt;
+      double prob;
+      auto res = std::from_chars(pos, end, src);
+      if (res.ec != std::errc())
+        return false;
+      res = std::from_chars(skip_blanks(res.ptr, end), end, tgt);
+      if (res.ec != std::errc())
+        return false;
+      res = std::from_chars(skip_blanks(res.ptr, end), end, prob);
+      if (res.ec != std::errc())
+        return false;
+      pos = skip_blanks(res.ptr, end);
+      if (pos < end && *pos != '\n')
+        return false;
+      pos++;
+      edges.sources.push_back(src);
+      edges.targets.push_back(tgt);
+      edges.probs.push_back(prob);
+    }
+    return true;
+  }
+};
+
+#endif /* defined(__oim__EdgeListParser__) */
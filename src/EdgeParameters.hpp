@@ -0,0 +1,549 @@
+/*
+ Copyright (c) 2015-2017 Paul Lagrée, Siyu Lei, Silviu Maniu, Luyi Mo
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#ifndef __oim__EdgeParameters__
+#define __oim__EdgeParameters__
+
+#include <vector>
+#include <random>
+
+#include "common.hpp"
+#include "FlatArray.hpp"
+#include "InfluenceDistribution.hpp"
+#include "SingleInfluence.hpp"
+#include "BetaInfluence.hpp"
+
+#define PARAMETERS_SINGLE 0  // Known influence values (SingleInfluence)
+#define PARAMETERS_BETA 1    // Beta posteriors on influence (BetaInfluence)
+#define PARAMETERS_FIXED 2   // Known influence values in fixed point
+#define PARAMETERS_CONSTANT 3  // Same known influence for all edges
+#define PARAMETERS_DEGREE 4    // Influence 1 / in-degree of the head of edges
+
+#define FIXED_POINT_ONE 4294967296.0  // 2^32, fixed-point value of 1
+
+/**
+  Influence parameters of all the edges of a graph, stored as a structure of
+  arrays indexed by edge id. It replaces the InfluenceDistribution object that
+  each edge used to carry: samplers read the influence of an edge directly in
+  flat arrays, without virtual calls nor reference counting.
+
+  All the edges of a graph have the same kind of parameters (PARAMETERS_SINGLE
+  for the real graph, PARAMETERS_BETA for the model graph), which is set when
+  the first edge is added. Known values can be quantized (PARAMETERS_FIXED,
+  see `quantize`). Known values can also be given by a weight model computed
+  from the topology instead of being stored by edge: a constant probability
+  (PARAMETERS_CONSTANT, see `constant`), or the weighted cascade model, whose
+  influence 1 / indeg(v) on edges entering v are also the weights of the
+  uniform LT model (PARAMETERS_DEGREE, see `weighted_cascade`). Accessors then
+  take the head of the edge, i.e. the node it enters.
+
+  Parameters are a weight layer over the topology of a graph: graphs sharing
+  a topology only differ by their EdgeParameters (see
+  `Graph::set_edge_parameters`), and layers built from another one share its
+  arrays when possible (e.g. the known influence of `beta_posteriors`).
+*/
+class EdgeParameters {
+ private:
+  int kind_ = -1;
+  // PARAMETERS_SINGLE (may be mapped from a binary graph file)
+  FlatArray<double> value_;
+  // PARAMETERS_FIXED: influence p is stored as threshold floor(p * 2^32),
+  // UINT32_MAX standing for p = 1 (see `to_threshold`)
+  FlatArray<uint32_t> threshold_;
+  // PARAMETERS_CONSTANT and PARAMETERS_DEGREE: number of edges, constant
+  // influence (and its threshold) or in-degrees of nodes
+  uedge_int n_implicit_ = 0;
+  double constant_ = 0;
+  uint32_t constant_threshold_ = 0;
+  FlatArray<uedge_int> in_degree_;
+  // PARAMETERS_BETA: the posterior of edge e is Beta(alpha_prior_ + hits_[e],
+  // beta_prior_ + misses_[e])
+  double alpha_prior_ = 1;  // Same for all edges, see `update_prior`
+  double beta_prior_ = 1;
+  LargeVector<unode_int> hits_;
+  LargeVector<unode_int> misses_;
+  LargeVector<double> upper_;     // Upper quartile (costly to compute)
+  std::shared_ptr<EdgeParameters> known_;  // Real influence, for squared errors
+  double round_ = 0;  // Same for all edges, see `set_round`
+  mutable std::default_random_engine gen_;  // For Thompson sampling
+
+ public:
+  EdgeParameters() : gen_(seed_ns()) {}
+
+  /**
+    Adds the parameters of `dist` as a new edge and returns its id.
+  */
+  uedge_int add(InfluenceDistribution& dist) {
+    if (auto single = dynamic_cast<SingleInfluence*>(&dist))
+      return add_single(single->get_value());
+    auto beta = dynamic_cast<BetaInfluence*>(&dist);
+    if (beta == nullptr) {
+      std::cerr << "Error: unknown type of influence distribution."
+                << std::endl;
+      exit(1);
+    }
+    set_kind(PARAMETERS_BETA);
+    alpha_prior_ = beta->get_alpha() - beta->get_hits();
+    beta_prior_ = beta->get_beta() - beta->get_misses();
+    hits_.push_back(beta->get_hits());
+    misses_.push_back(beta->get_misses());
+    upper_.push_back(beta->get_upper_quartile());
+    own_known().add_single(beta->get_original_mean());
+    round_ = beta->get_round();
+    return hits_.size() - 1;
+  }
+
+  /**
+    Adds an edge of known influence `value` and returns its id.
+  */
+  uedge_int add_single(double value) {
+    if (kind_ == PARAMETERS_CONSTANT || kind_ == PARAMETERS_DEGREE)
+      return n_implicit_++;  // The influence is given by the model
+    if (kind_ == PARAMETERS_FIXED) {
+      threshold_.push_back(to_threshold(value));
+      return threshold_.size() - 1;
+    }
+    set_kind(PARAMETERS_SINGLE);
+    value_.push_back(value);
+    return value_.size() - 1;
+  }
+
+  /**
+    Replaces known influence values by 32-bit fixed-point thresholds: an edge
+    is then live if a raw 32-bit random integer is below its threshold (see
+    `sample_live`), which needs one random integer instead of the two of a
+    random double, and halves the storage of values. Thresholds are exact up
+    to 2^-32, far below the precision of the weights of the graphs.
+  */
+  void quantize() {
+    if (kind_ != PARAMETERS_SINGLE)
+      return;
+    LargeVector<uint32_t> thresholds(value_.size());
+    for (uedge_int e = 0; e < value_.size(); e++)
+      thresholds[e] = to_threshold(value_[e]);
+    threshold_.assign(std::move(thresholds));
+    value_.clear();
+    kind_ = PARAMETERS_FIXED;
+  }
+
+  /**
+    Beta posteriors with prior (`alpha`, `beta`) for edges whose real influence
+    values are given by `known` (of any other kind), which is shared to
+    compute squared errors.
+  */
+  static EdgeParameters beta_posteriors(const EdgeParameters& known,
+                                        double alpha, double beta) {
+    EdgeParameters params;
+    uedge_int n = known.size();
+    params.set_kind(PARAMETERS_BETA);
+    params.alpha_prior_ = alpha;
+    params.beta_prior_ = beta;
+    params.hits_.assign(n, 0);
+    params.misses_.assign(n, 0);
+    params.upper_.assign(n, BetaInfluence::upper_quartile(alpha, beta));
+    params.known_ = std::make_shared<EdgeParameters>(known);
+    return params;
+  }
+
+  /**
+    Parameters of `n` edges of the same known influence `value`, which is not
+    stored by edge. Sampling an edge compares a random integer to a constant.
+  */
+  static EdgeParameters constant(uedge_int n, double value) {
+    EdgeParameters params;
+    params.set_kind(PARAMETERS_CONSTANT);
+    params.n_implicit_ = n;
+    params.constant_ = value;
+    params.constant_threshold_ = to_threshold(value);
+    return params;
+  }
+
+  /**
+    Parameters of the weighted cascade model for `n` edges: the influence of an
+    edge entering node v is 1 / `in_degree`[v]. Only the degrees of nodes are
+    stored.
+  */
+  static EdgeParameters weighted_cascade(uedge_int n,
+                                         FlatArray<uedge_int>&& in_degree) {
+    EdgeParameters params;
+    params.set_kind(PARAMETERS_DEGREE);
+    params.n_implicit_ = n;
+    params.in_degree_ = std::move(in_degree);
+    return params;
+  }
+
+  /**
+    Sets the in-degree of `node` (PARAMETERS_DEGREE), after a modification of
+    the graph.
+  */
+  void set_in_degree(unode_int node, uedge_int degree) {
+    if (kind_ != PARAMETERS_DEGREE)
+      return;
+    if (node >= in_degree_.size())
+      in_degree_.resize(node + 1, 0);
+    in_degree_.mutable_data()[node] = degree;
+  }
+
+  /**
+    Parameters of edges of known influence `values` (edge e has value e).
+  */
+  static EdgeParameters known_values(FlatArray<double>&& values) {
+    EdgeParameters params;
+    params.set_kind(PARAMETERS_SINGLE);
+    params.value_ = std::move(values);
+    return params;
+  }
+
+  /**
+    Reads `size` known influence values at byte `pos` of `file`.
+  */
+  void map_values(std::shared_ptr<const MappedFile> file, size_t pos,
+                  size_t size) {
+    set_kind(PARAMETERS_SINGLE);
+    value_.map(file, pos, size);
+  }
+
+  int get_kind() const { return kind_; }
+
+  /**
+    Known influence values of edges (PARAMETERS_SINGLE or PARAMETERS_FIXED,
+    values of weight models depend on the topology, see
+    `Graph::get_known_values`).
+  */
+  FlatArray<double> get_values() const {
+    if (kind_ != PARAMETERS_FIXED)
+      return value_;
+    FlatArray<double> values;
+    values.assign(threshold_.size(), 0.0);
+    double* vals = values.mutable_data();
+    for (uedge_int e = 0; e < threshold_.size(); e++)
+      vals[e] = from_threshold(threshold_[e]);
+    return values;
+  }
+
+  uedge_int size() const {
+    if (kind_ == PARAMETERS_BETA)
+      return hits_.size();
+    if (kind_ == PARAMETERS_CONSTANT || kind_ == PARAMETERS_DEGREE)
+      return n_implicit_;
+    return (kind_ == PARAMETERS_FIXED) ? threshold_.size() : value_.size();
+  }
+
+  /**
+    Influence of edge `e` entering node `head` for the given type of interval
+    (see `InfluenceDistribution::sample`).
+  */
+  inline double sample(uedge_int e, unode_int head, unsigned int type) const {
+    return sample(e, head, type, gen_);
+  }
+
+  /**
+    Same as above, influences drawn from the posteriors (INFLUENCE_THOMPSON)
+    being drawn with `gen` rather than the generator of the parameters, which
+    is shared by all their users.
+  */
+  template<typename Gen>
+  inline double sample(uedge_int e, unode_int head, unsigned int type,
+                       Gen& gen) const {
+    switch (kind_) {
+      case PARAMETERS_SINGLE:
+        return value_[e];
+      case PARAMETERS_FIXED:
+        return from_threshold(threshold_[e]);
+      case PARAMETERS_CONSTANT:
+        return constant_;
+      case PARAMETERS_DEGREE:
+        return 1.0 / in_degree_[head];
+    }
+    return BetaInfluence::sample_interval(alpha(e), beta(e), upper_[e],
+                                          round_, type, gen);
+  }
+
+  /**
+    Draws whether edge `e` entering node `head` is live with its influence for
+    the given type as probability, using `rng` (Xorshift or Xoshiro). Quantized and
+    constant values are compared to a single raw random integer r, as well as
+    the weighted cascade model (r * indeg(head) < 2^32, without division).
+  */
+  template<typename RNG>
+  inline bool sample_live(uedge_int e, unode_int head, unsigned int type,
+                          RNG& rng) const {
+    switch (kind_) {
+      case PARAMETERS_FIXED:
+        return (uint32_t)rng.gen_int() < live_threshold(threshold_[e]);
+      case PARAMETERS_CONSTANT:
+        return (uint32_t)rng.gen_int() < live_threshold(constant_threshold_);
+      case PARAMETERS_DEGREE:
+        return (uint64_t)(uint32_t)rng.gen_int() * in_degree_[head]
+            < (1ULL << 32);
+    }
+    double influence = sample(e, head, type, rng);  // Before the draw
+    return rng.gen_double() < influence;
+  }
+
+  /**
+    Draws whether each of the `n` edges of `edges` (at most 64, reversed if
+    `inv`) is live, as `sample_live`, and returns the live ones (bit i for
+    `edges[i]`). The random integers are taken from `rng` (Xoshiro) as a
+    block, and compared to the thresholds of the edges in a loop that the
+    compiler vectorizes.
+  */
+  template<typename Edge, typename RNG>
+  inline uint64_t live_edges(const Edge* edges, unsigned int n, bool inv,
+                             unsigned int type, RNG& rng) const {
+    uint64_t live = 0;
+    if (!is_deterministic(type)) {  // Draws would overwrite the block
+      for (unsigned int i = 0; i < n; i++)
+        live |= (uint64_t)sample_live(edges[i].id, edges[i].head(inv), type,
+                                      rng) << i;
+      return live;
+    }
+    const uint32_t* r = rng.gen_block(n);
+    switch (kind_) {
+      case PARAMETERS_FIXED:
+        for (unsigned int i = 0; i < n; i++) {
+          uint32_t threshold = threshold_[edges[i].id];
+          live |= (uint64_t)((r[i] < threshold) | (threshold == UINT32_MAX))
+              << i;
+        }
+        return live;
+      case PARAMETERS_CONSTANT:
+        if (constant_threshold_ == UINT32_MAX)
+          return (n == 64) ? ~0ULL : (1ULL << n) - 1;
+        for (unsigned int i = 0; i < n; i++)
+          live |= (uint64_t)(r[i] < constant_threshold_) << i;
+        return live;
+      case PARAMETERS_DEGREE:
+        for (unsigned int i = 0; i < n; i++)
+          live |= (uint64_t)((uint64_t)r[i] * in_degree_[edges[i].head(inv)]
+                             < (1ULL << 32)) << i;
+        return live;
+    }
+    for (unsigned int i = 0; i < n; i++)
+      live |= (uint64_t)(r[i] * (1.0 / FIXED_POINT_ONE)
+                         < sample(edges[i].id, edges[i].head(inv), type)) << i;
+    return live;
+  }
+
+  /**
+    Draws whether edge `e` entering node `head` is live in each of the
+    independent `worlds` (bit i for world i, up to 64), with its influence for
+    the given type as probability (see `is_deterministic`), and returns the
+    worlds where it is. The influence is taken in 32-bit fixed point. Up to 8
+    worlds draw a random integer each, as `sample_live`. More worlds draw
+    uniform fixed-point values compared to the influence bit-serially, from
+    the most significant bit, with one random 64-bit word per bit position: a
+    world is decided at its first bit differing from the influence, so that
+    about log2(#worlds) + 2 words are drawn for all of them.
+  */
+  template<typename RNG>
+  inline uint64_t live_mask(uedge_int e, unode_int head, unsigned int type,
+                            uint64_t worlds, RNG& rng) const {
+    uint64_t rest = worlds;  // Worlds after the 8 first ones
+    for (int i = 0; i < 8 && rest != 0; i++)
+      rest &= rest - 1;
+    if (rest == 0) {
+      for (uint64_t mask = worlds; mask != 0; mask &= mask - 1)
+        if (!sample_live(e, head, type, rng))
+          worlds &= ~(mask & -mask);
+      return worlds;
+    }
+    uint64_t threshold;  // Influence in fixed point, in [0, 2^32]
+    switch (kind_) {
+      case PARAMETERS_FIXED:
+        threshold = live_threshold(threshold_[e]);
+        break;
+      case PARAMETERS_CONSTANT:
+        threshold = live_threshold(constant_threshold_);
+        break;
+      case PARAMETERS_DEGREE:  // Same draws as `sample_live`
+        threshold = ((1ULL << 32) + in_degree_[head] - 1) / in_degree_[head];
+        break;
+      default:
+        double value = sample(e, head, type, rng);
+        threshold = (value <= 0) ? 0 : (value >= 1)
+            ? (1ULL << 32) : (uint64_t)(value * FIXED_POINT_ONE);
+    }
+    if (threshold >= (1ULL << 32))
+      return worlds;
+    uint64_t live = 0, undecided = (threshold > 0) ? worlds : 0;
+    for (int bit = 31; bit >= 0 && undecided != 0; bit--) {
+      uint64_t r = rng.gen_uint64();
+      if ((threshold >> bit) & 1) {  // Worlds drawing a 0 are below
+        live |= undecided & ~r;
+        undecided &= r;
+      } else {  // Worlds drawing a 1 are above
+        undecided &= ~r;
+      }
+    }
+    return live;
+  }
+
+  /**
+    Whether all the edges leaving a node (entering it if `inv`) have the same
+    influence, given by `shared_influence`: with a constant influence, or the
+    edges entering a node in the weighted cascade model.
+  */
+  bool has_shared_influence(bool inv) const {
+    return kind_ == PARAMETERS_CONSTANT || (kind_ == PARAMETERS_DEGREE && inv);
+  }
+
+  /**
+    Influence of all the edges of `node` (see `has_shared_influence`).
+  */
+  double shared_influence(unode_int node) const {
+    return (kind_ == PARAMETERS_CONSTANT) ? constant_ : 1.0 / in_degree_[node];
+  }
+
+  /**
+    Whether the influence of edges for the given type is the same at each
+    draw, i.e. not drawn from the posteriors (INFLUENCE_THOMPSON), so that
+    the worlds of `live_mask` can share it.
+  */
+  bool is_deterministic(unsigned int type) const {
+    return kind_ != PARAMETERS_BETA || type != INFLUENCE_THOMPSON;
+  }
+
+  double mean(uedge_int e, unode_int head) const {
+    if (kind_ != PARAMETERS_BETA)
+      return sample(e, head, 0);
+    return alpha(e) / (alpha(e) + beta(e));
+  }
+
+  void update(uedge_int e, unode_int hit, unode_int miss) {
+    if (kind_ != PARAMETERS_BETA)
+      return;
+    hits_[e] += hit;
+    misses_[e] += miss;
+    upper_[e] = BetaInfluence::upper_quartile(alpha(e), beta(e));
+  }
+
+  /**
+    Sets a new prior on all edges (it is the same for all edges).
+  */
+  void update_prior(double new_alpha, double new_beta) {
+    if (kind_ != PARAMETERS_BETA)
+      return;
+    alpha_prior_ = (new_alpha) > 0 ? new_alpha : 1.0;
+    beta_prior_ = (new_beta) > 0 ? new_beta : 1.0;
+    for (uedge_int e = 0; e < hits_.size(); e++)
+      upper_[e] = BetaInfluence::upper_quartile(alpha(e), beta(e));
+  }
+
+  double sq_error(uedge_int e, unode_int head) const {
+    if (kind_ != PARAMETERS_BETA || !known_)
+      return 0.0;
+    double error = mean(e, head) - known_->mean(e, head);
+    return error * error;
+  }
+
+  /**
+    Rounds are always updated for all edges at once, so that a single value is
+    kept.
+  */
+  void set_round(double new_round) { round_ += new_round; }
+
+  unode_int get_hits(uedge_int e) const {
+    return (kind_ == PARAMETERS_BETA) ? hits_[e] : 0;
+  }
+
+  unode_int get_misses(uedge_int e) const {
+    return (kind_ == PARAMETERS_BETA) ? misses_[e] : 0;
+  }
+
+  /**
+    Reorders the edges such that the new edge i is the former edge `order[i]`.
+    Edges absent from `order` are dropped.
+  */
+  void permute(const std::vector<uedge_int>& order) {
+    gather(value_, order);
+    gather(threshold_, order);
+    gather(hits_, order);
+    gather(misses_, order);
+    gather(upper_, order);
+    if (known_)
+      own_known().permute(order);
+    if (kind_ == PARAMETERS_CONSTANT || kind_ == PARAMETERS_DEGREE)
+      n_implicit_ = order.size();
+  }
+
+ private:
+  double alpha(uedge_int e) const { return alpha_prior_ + (double)hits_[e]; }
+
+  double beta(uedge_int e) const { return beta_prior_ + (double)misses_[e]; }
+
+  /**
+    Known influence of the edges, not shared with copies of the parameters.
+  */
+  EdgeParameters& own_known() {
+    if (!known_)
+      known_ = std::make_shared<EdgeParameters>();
+    else if (known_.use_count() > 1)
+      known_ = std::make_shared<EdgeParameters>(*known_);
+    return *known_;
+  }
+
+  void set_kind(int kind) {
+    if (kind_ != -1 && kind_ != kind) {
+      std::cerr << "Error: all edges of a graph must have the same type of "
+                << "influence distribution." << std::endl;
+      exit(1);
+    }
+    kind_ = kind;
+  }
+
+  /**
+    Fixed-point threshold floor(value * 2^32) of an influence. Influences of
+    1 (or within 2^-32 of it) saturate to UINT32_MAX, which stands for edges
+    that are always live (see `live_threshold`).
+  */
+  static uint32_t to_threshold(double value) {
+    if (value <= 0)
+      return 0;
+    return (value >= 1) ? UINT32_MAX : (uint32_t)(value * FIXED_POINT_ONE);
+  }
+
+  static double from_threshold(uint32_t threshold) {
+    return (threshold == UINT32_MAX) ? 1.0 : threshold / FIXED_POINT_ONE;
+  }
+
+  /**
+    Bound in [0, 2^32] below which a random 32-bit integer makes an edge of
+    the given threshold live.
+  */
+  static uint64_t live_threshold(uint32_t threshold) {
+    return (threshold == UINT32_MAX) ? (1ULL << 32) : threshold;
+  }
+
+  template<typename Array>
+  static void gather(Array& values, const std::vector<uedge_int>& order) {
+    if (values.empty())
+      return;
+    Array result;
+    result.reserve(order.size());
+    for (uedge_int i = 0; i < order.size(); i++)
+      result.push_back(values[order[i]]);
+    values = std::move(result);
+  }
+};
+
+#endif /* defined(__oim__EdgeParameters__) */
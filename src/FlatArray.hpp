@@ -0,0 +1,235 @@
+/*
+ Copyright (c) 2015-2017 Paul Lagrée, Siyu Lei, Silviu Maniu, Luyi Mo
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#ifndef __oim__FlatArray__
+#define __oim__FlatArray__
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common.hpp"
+#include "LargeAllocator.hpp"
+
+
+/**
+  Read-only memory mapping of a whole file. Pages are shared with every other
+  process mapping the same file.
+*/
+class MappedFile {
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+
+ public:
+  MappedFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+      std::cerr << "Error: cannot open " << filename << std::endl;
+      exit(1);
+    }
+    size_ = st.st_size;
+    if (size_ > 0) {
+      void* addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED) {
+        std::cerr << "Error: cannot map " << filename << std::endl;
+        exit(1);
+      }
+      data_ = (const char*)addr;
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data_ != nullptr)
+      munmap((void*)data_, size_);
+  }
+
+  const char* data() const { return data_; }
+
+  size_t size() const { return size_; }
+};
+
+/**
+  Array of plain values used for the large arrays of the graph. The values are
+  either owned (in a LargeVector, see `LargeMemory`) or read in place from a
+  MappedFile, which is kept alive as long as an array points into it. Copies of an array share its
+  values until one of them is modified (copy on write), so that copies of a
+  graph do not duplicate its topology. A mapped array is copied in memory
+  before its first modification.
+*/
+template<typename T>
+class FlatArray {
+ private:
+  std::shared_ptr<LargeVector<T>> owned_;   // nullptr if empty or mapped
+  std::shared_ptr<const MappedFile> file_;  // nullptr if values are owned
+  const T* data_ = nullptr;
+  size_t size_ = 0;
+
+ public:
+  FlatArray() = default;
+
+  FlatArray(const FlatArray& a) = default;
+
+  FlatArray(FlatArray&& a)
+      : owned_(std::move(a.owned_)), file_(std::move(a.file_)),
+        data_(a.data_), size_(a.size_) {
+    a.clear();
+  }
+
+  FlatArray& operator=(const FlatArray& a) = default;
+
+  FlatArray& operator=(FlatArray&& a) {
+    owned_ = std::move(a.owned_);
+    file_ = std::move(a.file_);
+    data_ = a.data_;
+    size_ = a.size_;
+    a.clear();
+    return *this;
+  }
+
+  /**
+    Points the array to `size` values starting at byte `pos` of `file`.
+  */
+  void map(std::shared_ptr<const MappedFile> file, size_t pos, size_t size) {
+    if (pos % alignof(T) != 0 || pos + size * sizeof(T) > file->size()) {
+      std::cerr << "Error: corrupted binary graph file." << std::endl;
+      exit(1);
+    }
+    owned_.reset();
+    file_ = file;
+    data_ = (const T*)(file->data() + pos);
+    size_ = size;
+  }
+
+  bool is_mapped() const { return file_ != nullptr; }
+
+  const T* data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  const T& operator[](size_t i) const { return data_[i]; }
+
+  const T* begin() const { return data_; }
+
+  const T* end() const { return data_ + size_; }
+
+  /**
+    Pointer to modifiable values (the size of the array cannot change).
+  */
+  T* mutable_data() {
+    own();
+    sync();
+    return owned_->data();
+  }
+
+  void assign(size_t size, const T& value) {
+    file_.reset();
+    owned_ = std::make_shared<LargeVector<T>>(size, value);
+    sync();
+  }
+
+  /**
+    Takes the values of `values` without copying them.
+  */
+  void assign(LargeVector<T>&& values) {
+    file_.reset();
+    owned_ = std::make_shared<LargeVector<T>>(std::move(values));
+    sync();
+  }
+
+  void resize(size_t size, const T& value) {
+    own();
+    owned_->resize(size, value);
+    sync();
+  }
+
+  void reserve(size_t size) {
+    own();
+    owned_->reserve(size);
+    sync();
+  }
+
+  void push_back(const T& value) {
+    own();
+    owned_->push_back(value);
+    sync();
+  }
+
+  template<typename It>
+  void append(It first, It last) {
+    own();
+    owned_->insert(owned_->end(), first, last);
+    sync();
+  }
+
+  /**
+    Empties the array and releases its memory (if not shared).
+  */
+  void clear() {
+    owned_.reset();
+    file_.reset();
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  /**
+    Memory used by the values (0 if mapped, as pages belong to the file).
+  */
+  size_t memory() const {
+    return owned_ ? owned_->capacity() * sizeof(T) : 0;
+  }
+
+ private:
+  /**
+    Makes the values owned by this array only.
+  */
+  void own() {
+    if (file_) {
+      owned_ = std::make_shared<LargeVector<T>>(data_, data_ + size_);
+      file_.reset();
+    } else if (!owned_) {
+      owned_ = std::make_shared<LargeVector<T>>();
+    } else if (owned_.use_count() > 1) {
+      owned_ = std::make_shared<LargeVector<T>>(*owned_);
+    }
+  }
+
+  void sync() {
+    data_ = owned_->data();
+    size_ = owned_->size();
+  }
+};
+
+#endif /* defined(__oim__FlatArray__) */
@@ -28,53 +28,376 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <cstring>
 
 #include "common.hpp"
 #include "InfluenceDistribution.hpp"
+#include "EdgeParameters.hpp"
+#include "FlatArray.hpp"
+#include "EdgeListParser.hpp"
 #include <boost/random/mersenne_twister.hpp>
 
+#define BINARY_GRAPH_MAGIC "OIMGRAPH"
+#define BINARY_GRAPH_VERSION 3
+#define BINARY_GRAPH_SECTIONS 7
+#define BINARY_GRAPH_ALIGN 64
+#define BINARY_GRAPH_SYMMETRIC 1  // Flag of undirected graphs (no reversed lists)
 
+#define NO_EDGE ((uedge_int)-1)  // Edge id returned when an edge is not found
+
+
+/**
+  Edge of the graph. Its influence parameters are found in the EdgeParameters
+  of the graph at index `id` (an edge and its reversed edge share the same id).
+*/
 class EdgeType {
  public:
   unode_int source;
   unode_int target;
-  std::shared_ptr<InfluenceDistribution> dist;
-  EdgeType(unode_int src, unode_int tgt,
-           std::shared_ptr<InfluenceDistribution> dst)
-      : source(src), target(tgt), dist(dst) {};
+  uedge_int id;
+  EdgeType(unode_int src, unode_int tgt, uedge_int eid)
+      : source(src), target(tgt), id(eid) {};
+
+  /**
+    Node entered by the edge, if it is a reversed edge (`inv`) or not.
+  */
+  unode_int head(bool inv) const { return inv ? source : target; }
+};
+
+/**
+  Appends `value` to `bytes` as a varint (7 bits per byte, least significant
+  first, the high bit of a byte is set if another byte follows).
+*/
+inline void write_varint(LargeVector<uint8_t>& bytes, uint32_t value) {
+  while (value >= 0x80) {
+    bytes.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  bytes.push_back((uint8_t)value);
+}
+
+/**
+  Reads a varint written by `write_varint` at `pos` and moves `pos` after it.
+*/
+inline uint32_t read_varint(const uint8_t*& pos) {
+  uint32_t value = *pos & 0x7F;
+  for (int shift = 7; *pos++ & 0x80; shift += 7)
+    value |= (uint32_t)(*pos & 0x7F) << shift;
+  return value;
+}
+
+/**
+  Lightweight view on the list of edges of a node, as returned by
+  `Graph::get_neighbours`. It does not own the edges and is invalidated as soon
+  as the graph is modified. The list is either a contiguous array of edges, or
+  a compressed list (see `Graph::compress`) which is decoded on the fly by the
+  iterator: edges are then only valid until the iterator moves. For frozen
+  graphs modified since (see `Graph::compact`), the edges of the delta are
+  chained after the base list and deleted edges are skipped.
+*/
+class EdgeRange {
+ private:
+  const EdgeType* edges_ = nullptr;  // Plain list, nullptr if compressed
+  const uint8_t* bytes_ = nullptr;   // Compressed list
+  size_t base_size_ = 0;             // Number of edges of the base list
+  unode_int node_ = 0;
+  uedge_int first_id_ = 0;                  // Id of the first forward edge
+  const uedge_int* out_offsets_ = nullptr;  // To decode ids of reversed edges
+  const EdgeType* extra_ = nullptr;         // Edges of the delta
+  size_t extra_size_ = 0;
+  const uint64_t* deleted_ = nullptr;  // Bitmap of deleted edge ids, if any
+  size_t size_ = 0;                    // Number of live edges
+
+ public:
+  class iterator {
+   private:
+    const EdgeType* edges_;
+    const uint8_t* next_;
+    size_t i_;
+    size_t base_size_;
+    size_t total_;
+    uedge_int first_id_;
+    const uedge_int* out_offsets_;
+    const EdgeType* extra_;
+    const uint64_t* deleted_;
+    EdgeType edge_;  // Current edge of a compressed list
+
+    /**
+      Decodes edge i_: the gap with the previous neighbour, then (reversed
+      edges only) the index of the edge in the list of its source.
+    */
+    void decode() {
+      if (i_ >= base_size_)
+        return;
+      edge_.target += read_varint(next_);
+      if (out_offsets_ != nullptr)
+        edge_.id = out_offsets_[edge_.target] + read_varint(next_);
+      else
+        edge_.id = first_id_ + i_;
+    }
+
+    void skip_deleted() {
+      while (deleted_ != nullptr && i_ < total_
+             && (deleted_[(**this).id / 64] >> ((**this).id % 64)) & 1) {
+        i_++;
+        if (edges_ == nullptr)
+          decode();
+      }
+    }
+
+   public:
+    iterator(const EdgeRange& range, size_t i)
+        : edges_(range.edges_), next_(range.bytes_), i_(i),
+          base_size_(range.base_size_),
+          total_(range.base_size_ + range.extra_size_),
+          first_id_(range.first_id_), out_offsets_(range.out_offsets_),
+          extra_(range.extra_), deleted_(range.deleted_),
+          edge_(range.node_, 0, 0) {
+      if (edges_ == nullptr)
+        decode();
+      skip_deleted();
+    }
+
+    const EdgeType& operator*() const {
+      if (i_ >= base_size_)
+        return extra_[i_ - base_size_];
+      return (edges_ != nullptr) ? edges_[i_] : edge_;
+    }
+
+    const EdgeType* operator->() const { return &**this; }
+
+    iterator& operator++() {
+      i_++;
+      if (edges_ == nullptr)
+        decode();
+      skip_deleted();
+      return *this;
+    }
+
+    bool operator!=(const iterator& it) const { return i_ != it.i_; }
+
+    bool operator==(const iterator& it) const { return i_ == it.i_; }
+  };
+
+  EdgeRange() = default;
+
+  EdgeRange(const EdgeType* begin, const EdgeType* end)
+      : edges_(begin), base_size_(end - begin), size_(end - begin) {}
+
+  EdgeRange(const uint8_t* bytes, size_t size, unode_int node,
+            uedge_int first_id, const uedge_int* out_offsets)
+      : bytes_(bytes), base_size_(size), node_(node), first_id_(first_id),
+        out_offsets_(out_offsets), size_(size) {}
+
+  /**
+    Chains the edges `extra` of the delta after the list, and skips the edges
+    deleted in `deleted`. The list has then `size` live edges.
+  */
+  void set_delta(const EdgeType* extra, size_t extra_size,
+                 const uint64_t* deleted, size_t size) {
+    extra_ = extra;
+    extra_size_ = extra_size;
+    deleted_ = deleted;
+    size_ = size;
+  }
+
+  iterator begin() const { return iterator(*this, 0); }
+
+  iterator end() const { return iterator(*this, base_size_ + extra_size_); }
+
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  /**
+    Edges of a plain list, for random access, or nullptr if the list is
+    compressed or has a delta.
+  */
+  const EdgeType* data() const {
+    return (extra_size_ == 0 && deleted_ == nullptr) ? edges_ : nullptr;
+  }
+
+  /**
+    Edge i of the list (in linear time for compressed lists or lists with a
+    delta).
+  */
+  EdgeType operator[](size_t i) const {
+    if (edges_ != nullptr && extra_size_ == 0 && deleted_ == nullptr)
+      return edges_[i];
+    auto it = begin();
+    for (; i > 0; i--)
+      ++it;
+    return *it;
+  }
+};
+
+/**
+  Range over the ids of the nodes of a graph in increasing order, as returned by
+  `Graph::get_nodes`. Nodes are read in a bitmap (bit i is set if node i is in
+  the graph).
+*/
+class NodeRange {
+ private:
+  const uint64_t* words_ = nullptr;
+  size_t n_words_ = 0;
+
+ public:
+  class iterator {
+   private:
+    const uint64_t* words_;
+    size_t n_words_;
+    size_t pos_;      // Position of the current node in the bitmap
+    unode_int node_;
+
+    void seek() {  // Moves to the first node whose id is at least pos_
+      size_t word = pos_ / 64;
+      if (word >= n_words_) {
+        pos_ = n_words_ * 64;
+        return;
+      }
+      uint64_t bits = words_[word] & (~0ULL << (pos_ % 64));
+      while (bits == 0) {
+        if (++word == n_words_) {
+          pos_ = n_words_ * 64;
+          return;
+        }
+        bits = words_[word];
+      }
+      pos_ = word * 64 + __builtin_ctzll(bits);
+      node_ = pos_;
+    }
+
+   public:
+    iterator(const uint64_t* words, size_t n_words, size_t pos)
+        : words_(words), n_words_(n_words), pos_(pos), node_(0) { seek(); }
+
+    const unode_int& operator*() const { return node_; }
+
+    iterator& operator++() {
+      pos_++;
+      seek();
+      return *this;
+    }
+
+    bool operator!=(const iterator& it) const { return pos_ != it.pos_; }
+
+    bool operator==(const iterator& it) const { return pos_ == it.pos_; }
+  };
+
+  NodeRange(const uint64_t* words, size_t n_words)
+      : words_(words), n_words_(n_words) {}
+
+  iterator begin() const { return iterator(words_, n_words_, 0); }
+
+  iterator end() const { return iterator(words_, n_words_, n_words_ * 64); }
+};
+
+/**
+  Header of the binary format of graphs (see `Graph::save_binary`). Sections
+  follow the header in the order: node bitmap, forward offsets, forward edges,
+  reversed offsets, reversed edges, influence probabilities, original ids of
+  nodes (empty if the graph was not reordered). Reversed sections are empty for
+  symmetric graphs (flag BINARY_GRAPH_SYMMETRIC). They are aligned so that they
+  can be used in place once the file is memory-mapped.
+*/
+struct BinaryGraphHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t node_size;   // sizeof(unode_int)
+  uint32_t offset_size; // sizeof(uedge_int)
+  uint32_t edge_size;   // sizeof(EdgeType)
+  uint32_t flags;       // BINARY_GRAPH_SYMMETRIC
+  uint32_t reserved;
+  uint64_t n_nodes;
+  uint64_t n_edges;
+  uint64_t pos[BINARY_GRAPH_SECTIONS];   // Position of sections in the file
+  uint64_t size[BINARY_GRAPH_SECTIONS];  // Number of elements of sections
 };
 
 /**
   Class representing the graph. Be careful:
     - nodes index starts at 0 up to n - 1
+    - the graph is built in hash maps, then it should be frozen (see `freeze`)
+      in a compressed sparse row layout for the sampling algorithms
+    - a frozen graph can be saved in a binary file, which is memory-mapped and
+      used in place when loaded (see `save_binary` and `load_binary`)
+    - a frozen graph can also be compressed (see `compress`) to fit larger
+      graphs in memory
+    - nodes can be renumbered for locality (see `reorder_nodes`), the ids of
+      the input are then given by `original_id`
+    - edges added to or removed from a frozen graph go to a delta over the
+      frozen base, which is merged in the base from time to time (see
+      `compact`)
+    - undirected graphs can be stored in a symmetric layout, with one list of
+      neighbours per node (see `assign_undirected_edges`)
 */
 class Graph {
  private:
   std::unordered_map<unode_int, std::vector<EdgeType>> adj_list_;
   std::unordered_map<unode_int, std::vector<EdgeType>> inv_adj_list_;
-  // For each node, if LT model was activated in graph loading, we have the
-  // distribution to sample an incoming edge according to its weight.
-  std::unordered_map<
-      unode_int, std::discrete_distribution<>> mutable lt_dist_;
-  std::unordered_set<unode_int> node_set_;
+  // For the LT model (see `build_lt_distribution`), alias tables to sample an
+  // incoming edge of each node according to its weight. The slots of node u
+  // are lt_offsets_[u] to lt_offsets_[u + 1] - 1: one per reversed edge, plus
+  // a last one for no edge. Slot i is kept if a random 32-bit integer is
+  // below lt_threshold_[i], otherwise its alias lt_alias_[i] is taken.
+  FlatArray<uedge_int> lt_offsets_;
+  FlatArray<uint32_t> lt_threshold_;
+  FlatArray<uint32_t> lt_alias_;
+  unsigned int lt_type_ = 0;  // Type of influence of the alias tables
+  FlatArray<uint64_t> node_bits_;  // Bitmap of nodes in the graph
+  EdgeParameters params_;
   unode_int num_edges_ = 0;
   unode_int num_nodes_ = 0;
+  // Frozen compressed sparse row layout. The edges leaving (resp. entering)
+  // node u are out_edges_[out_offsets_[u]] to out_edges_[out_offsets_[u + 1] - 1]
+  // (resp. in_edges_ indexed by in_offsets_). Hash maps are empty when frozen.
+  bool frozen_ = false;
+  // Undirected graph (see `assign_undirected_edges`): the reversed arrays are
+  // the forward ones (shared), and both edges of an undirected edge have the
+  // same id
+  bool symmetric_ = false;
+  FlatArray<uedge_int> out_offsets_;
+  FlatArray<EdgeType> out_edges_;
+  FlatArray<uedge_int> in_offsets_;
+  FlatArray<EdgeType> in_edges_;
+  // Compressed lists of edges (see `compress`), edges are then released
+  bool compressed_ = false;
+  FlatArray<uint64_t> out_pos_;  // Lists of node u start at out_bytes_[out_pos_[u]]
+  FlatArray<uint8_t> out_bytes_;
+  FlatArray<uint64_t> in_pos_;
+  FlatArray<uint8_t> in_bytes_;
+  // Ids of nodes in the input if they were renumbered (see `reorder_nodes`),
+  // empty otherwise
+  FlatArray<unode_int> original_ids_;
+  FlatArray<unode_int> internal_ids_;  // Inverse permutation
+  // Delta over the frozen base (see `compact`): lists of added edges, bitmap
+  // of deleted edge ids (empty if none) and number of deleted edges by node
+  std::unordered_map<unode_int, std::vector<EdgeType>> delta_out_;
+  std::unordered_map<unode_int, std::vector<EdgeType>> delta_in_;
+  FlatArray<uint64_t> deleted_;
+  std::unordered_map<unode_int, uedge_int> deleted_out_;
+  std::unordered_map<unode_int, uedge_int> deleted_in_;
+  uedge_int delta_size_ = 0;  // Number of added and deleted edges
+  // Index of the edges of the frozen base for `find_edge`: the edges leaving
+  // node u, sorted by target, have targets index_targets_[out_offsets_[u]] to
+  // index_targets_[out_offsets_[u + 1] - 1] and ids in index_ids_. It is built
+  // on first use and cleared when edges are renumbered.
+  mutable bool indexed_ = false;
+  mutable FlatArray<unode_int> index_targets_;
+  mutable FlatArray<uedge_int> index_ids_;
 
  public:
   double alpha_prior, beta_prior;
 
   Graph() = default;
 
-  Graph(const Graph& g)
-      : adj_list_(g.adj_list_), inv_adj_list_(g.inv_adj_list_),
-        lt_dist_(g.lt_dist_), node_set_(g.node_set_), num_edges_(g.num_edges_),
-        num_nodes_(g.num_nodes_) {}
+  Graph(const Graph& g) = default;
+
+  Graph(Graph&& g) = default;
 
-  Graph(Graph&& g)
-      : adj_list_(std::move(g.adj_list_)),
-        inv_adj_list_(std::move(g.inv_adj_list_)),
-        lt_dist_(std::move(g.lt_dist_)), node_set_(std::move(g.node_set_)),
-        num_edges_(std::move(g.num_edges_)), num_nodes_(std::move(g.num_nodes_)) {}
+  Graph& operator=(const Graph& g) = default;
+
+  Graph& operator=(Graph&& g) = default;
 
   void set_prior(double alpha, double beta) {
     alpha_prior = alpha;
@@ -82,39 +405,536 @@ class Graph {
   }
 
   /**
-    Adds an edge and the corresponding inversed edge to the Graph.
+    Adds an edge and the corresponding inversed edge to the Graph. Only the
+    parameters of `dist` are kept (see EdgeParameters).
   */
   void add_edge(unode_int source, unode_int target,
                 std::shared_ptr<InfluenceDistribution> dist) {
-    add_node(source);
-    add_node(target);
-    EdgeType edge1(source, target, dist);
-    EdgeType edge2(target, source, dist);
-    adj_list_[source].push_back(edge1);
-    inv_adj_list_[target].push_back(edge2);
-    num_edges_++;
+    if (symmetric_)
+      compact();
+    insert_edge(source, target, params_.add(*dist));
   };
 
+  /**
+    Adds an edge of known influence probability `prob` (SingleInfluence).
+  */
+  void add_edge(unode_int source, unode_int target, double prob) {
+    if (symmetric_)
+      compact();
+    insert_edge(source, target, params_.add_single(prob));
+  }
+
+  /**
+    Removes the first edge from `source` to `target`, if any.
+  */
+  void remove_edge(unode_int source, unode_int target) {
+    if (symmetric_)
+      compact();
+    if (frozen_) {
+      uedge_int id = find_edge(source, target);
+      if (id != NO_EDGE)
+        delete_edge(EdgeType(source, target, id));
+      compact_if_needed();
+      return;
+    }
+    auto it = adj_list_.find(source);
+    if (it == adj_list_.end())
+      return;
+    auto edge = std::find_if(it->second.begin(), it->second.end(),
+                             [target](auto& e) { return e.target == target; });
+    if (edge == it->second.end())
+      return;
+    auto& inv_list = inv_adj_list_[target];
+    uedge_int id = edge->id;
+    inv_list.erase(std::find_if(inv_list.begin(), inv_list.end(),
+                                [id](auto& e) { return e.id == id; }));
+    it->second.erase(edge);
+    if (it->second.empty())
+      adj_list_.erase(it);
+    if (inv_list.empty())
+      inv_adj_list_.erase(target);
+    num_edges_--;
+    update_in_degree(target);
+  }
+
   /**
     Adds a node to the Graph.
   */
   void add_node(unode_int node) {
-    node_set_.insert(node);
-    num_nodes_ = node_set_.size();
+    if (node / 64 >= node_bits_.size())
+      node_bits_.resize(node / 64 + 1, 0);
+    uint64_t bit = 1ULL << (node % 64);
+    if ((node_bits_[node / 64] & bit) == 0) {
+      node_bits_.mutable_data()[node / 64] |= bit;
+      num_nodes_++;
+    }
+  }
+
+  /**
+    Freezes the graph in a compressed sparse row layout: the lists of edges of
+    all nodes are packed in two contiguous arrays (forward and reversed edges)
+    indexed by offset arrays, and the hash maps are released. Neighbours are
+    then obtained without any hashing. It must be called once the graph is
+    entirely loaded; a frozen graph is transparently thawed if it is modified.
+  */
+  void freeze() {
+    if (frozen_)
+      return;
+    unode_int n_ids = 0;  // Node ids range from 0 to n_ids - 1
+    for (auto node : get_nodes())
+      n_ids = node + 1;
+    build_csr(adj_list_, n_ids, out_offsets_, out_edges_);
+    build_csr(inv_adj_list_, n_ids, in_offsets_, in_edges_);
+    renumber_edges();
+    std::unordered_map<unode_int, std::vector<EdgeType>>().swap(adj_list_);
+    std::unordered_map<unode_int, std::vector<EdgeType>>().swap(inv_adj_list_);
+    frozen_ = true;
+  }
+
+  /**
+    Goes back from the compressed sparse row layout to the hash maps, to allow
+    modifications of the graph structure.
+  */
+  void thaw() {
+    if (!frozen_)
+      return;
+    compact();
+    decompress();
+    expand_csr(out_offsets_, out_edges_, adj_list_);
+    expand_csr(in_offsets_, in_edges_, inv_adj_list_);
+    clear_edge_index();
+    frozen_ = false;
+  }
+
+  /**
+    Compresses the lists of edges of the frozen graph (it is frozen first).
+    Forward lists are sorted by target and stored as varint gaps between
+    successive targets, edge ids being implicit. Reversed lists are sorted by
+    source and store the gaps between sources followed by the index of the
+    edge in the forward list of its source. Edges use a few bytes instead of
+    2 * sizeof(EdgeType), and are decoded on the fly by `get_neighbours`. The
+    graph is transparently decompressed if it is modified.
+  */
+  void compress() {
+    if (compressed_)
+      return;
+    freeze();
+    compact();
+    unode_int n_ids = out_offsets_.size() - 1;
+    EdgeType* out_edges = out_edges_.mutable_data();
+    for (unode_int u = 0; u < n_ids; u++) {
+      std::stable_sort(out_edges + out_offsets_[u],
+                       out_edges + out_offsets_[u + 1],
+                       [](auto& e1, auto& e2) { return e1.target < e2.target; });
+    }
+    renumber_edges();
+    clear_edge_index();
+    LargeVector<uint8_t> bytes;
+    out_pos_.assign(n_ids + 1, 0);
+    uint64_t* pos = out_pos_.mutable_data();
+    for (unode_int u = 0; u < n_ids; u++) {
+      pos[u] = bytes.size();
+      unode_int prev = 0;
+      for (uedge_int i = out_offsets_[u]; i < out_offsets_[u + 1]; i++) {
+        write_varint(bytes, out_edges_[i].target - prev);
+        prev = out_edges_[i].target;
+      }
+    }
+    pos[n_ids] = bytes.size();
+    bytes.shrink_to_fit();
+    out_bytes_.assign(std::move(bytes));
+    out_edges_.clear();
+    bytes = LargeVector<uint8_t>();
+    in_pos_.assign(n_ids + 1, 0);
+    pos = in_pos_.mutable_data();
+    std::vector<EdgeType> lst;
+    for (unode_int u = 0; u < n_ids; u++) {
+      pos[u] = bytes.size();
+      lst.assign(in_edges_.begin() + in_offsets_[u],
+                 in_edges_.begin() + in_offsets_[u + 1]);
+      std::sort(lst.begin(), lst.end(), [](auto& e1, auto& e2) {
+        return (e1.target < e2.target)
+            || (e1.target == e2.target && e1.id < e2.id);
+      });
+      unode_int prev = 0;
+      for (auto& edge : lst) {
+        write_varint(bytes, edge.target - prev);
+        write_varint(bytes, edge.id - out_offsets_[edge.target]);
+        prev = edge.target;
+      }
+    }
+    pos[n_ids] = bytes.size();
+    bytes.shrink_to_fit();
+    in_bytes_.assign(std::move(bytes));
+    in_edges_.clear();
+    compressed_ = true;
+  }
+
+  /**
+    Goes back from compressed lists of edges to the plain frozen layout.
+  */
+  void decompress() {
+    if (!compressed_)
+      return;
+    compact();
+    unode_int n_ids = out_offsets_.size() - 1;
+    LargeVector<EdgeType> out_edges, in_edges;
+    out_edges.reserve(num_edges_);
+    in_edges.reserve(num_edges_);
+    for (unode_int u = 0; u < n_ids; u++) {
+      for (auto& edge : get_neighbours(u))
+        out_edges.push_back(edge);
+      for (auto& edge : get_neighbours(u, true))
+        in_edges.push_back(edge);
+    }
+    out_edges_.assign(std::move(out_edges));
+    in_edges_.assign(std::move(in_edges));
+    out_pos_.clear();
+    out_bytes_.clear();
+    in_pos_.clear();
+    in_bytes_.clear();
+    compressed_ = false;
+  }
+
+  bool is_compressed() const { return compressed_; }
+
+  /**
+    Merges the delta of a frozen graph in its base. Edges added to (resp.
+    removed from) a frozen graph are appended to (resp. marked in) a delta, so
+    that updates cost O(degree) and the graph stays frozen; samplers iterate
+    the base and the delta together. The delta is compacted automatically
+    when it reaches 1/8 of the base. Edges are renumbered (see
+    `renumber_edges`). A symmetric graph is converted to the directed layout,
+    both edges of an undirected edge getting their own id and a copy of its
+    parameters: it is done before any modification of a symmetric graph.
+  */
+  void compact() {
+    if (delta_size_ == 0 && !symmetric_)
+      return;
+    bool compressed = compressed_;
+    unode_int n_ids = 0;
+    for (auto node : get_nodes())
+      n_ids = node + 1;
+    LargeVector<uedge_int> offsets(n_ids + 1, 0);
+    LargeVector<EdgeType> edges;
+    std::vector<uedge_int> order;  // Old ids of the edges
+    edges.reserve(num_edges_);
+    order.reserve(num_edges_);
+    for (unode_int u = 0; u < n_ids; u++) {
+      offsets[u] = edges.size();
+      for (auto& edge : get_neighbours(u)) {
+        order.push_back(edge.id);
+        edges.push_back(EdgeType(u, edge.target, edges.size()));
+      }
+    }
+    offsets[n_ids] = edges.size();
+    std::vector<unode_int> sources(edges.size()), targets(edges.size());
+    std::vector<uedge_int> ids(edges.size());
+    for (uedge_int i = 0; i < edges.size(); i++) {
+      sources[i] = edges[i].source;
+      targets[i] = edges[i].target;
+      ids[i] = i;
+    }
+    counting_sort_csr(targets, sources, ids.data(), n_ids, 1, in_offsets_,
+                      in_edges_, nullptr);
+    out_offsets_.assign(std::move(offsets));
+    out_edges_.assign(std::move(edges));
+    params_.permute(order);
+    delta_out_.clear();
+    delta_in_.clear();
+    deleted_.clear();
+    deleted_out_.clear();
+    deleted_in_.clear();
+    delta_size_ = 0;
+    symmetric_ = false;
+    clear_edge_index();
+    out_pos_.clear();
+    out_bytes_.clear();
+    in_pos_.clear();
+    in_bytes_.clear();
+    compressed_ = false;
+    if (compressed)
+      compress();
+  }
+
+  /**
+    Number of edges added to or removed from the frozen base (see `compact`).
+  */
+  uedge_int get_delta_size() const { return delta_size_; }
+
+  /**
+    Memory used by the adjacency of the graph (frozen or compressed layouts
+    only), in bytes.
+  */
+  size_t adjacency_memory() const {
+    size_t memory = out_offsets_.memory() + out_edges_.memory()
+        + out_pos_.memory() + out_bytes_.memory() + in_pos_.memory()
+        + in_bytes_.memory();
+    if (!symmetric_)  // Reversed arrays are shared otherwise
+      memory += in_offsets_.memory() + in_edges_.memory();
+    return memory;
+  }
+
+  /**
+    Renumbers the nodes for memory locality of the traversals: nodes are
+    numbered in the order of a breadth-first search on the undirected graph,
+    started from the nodes of highest degree. Neighbours, and thus the states
+    of nodes visited together by samplers, get close ids. Ids that are not
+    nodes of the graph come last. Only graphs of known influence can be
+    reordered, before the model graph is copied from them.
+  */
+  void reorder_nodes() {
+    int kind = params_.get_kind();
+    if (kind == PARAMETERS_BETA) {
+      std::cerr << "Error: only graphs of known influence can be reordered."
+                << std::endl;
+      exit(1);
+    }
+    freeze();
+    bool symmetric = symmetric_;
+    if (!symmetric)
+      compact();
+    std::vector<unode_int> order = locality_order();  // order[new] = old
+    LargeVector<unode_int> new_ids(order.size());
+    for (unode_int i = 0; i < order.size(); i++)
+      new_ids[order[i]] = i;
+    EdgeList edges;
+    edges.sources.reserve(num_edges_);
+    edges.targets.reserve(num_edges_);
+    edges.probs.reserve(num_edges_);
+    FlatArray<double> values = get_known_values();
+    double constant = params_.mean(0, 0);  // For PARAMETERS_CONSTANT
+    std::vector<bool> seen(symmetric ? params_.size() : 0, false);
+    for (unode_int u = 0; u < order.size(); u++) {
+      for (auto& edge : get_neighbours(order[u])) {
+        if (symmetric) {  // Undirected edges are listed once
+          if (seen[edge.id])
+            continue;
+          seen[edge.id] = true;
+        }
+        edges.sources.push_back(u);
+        edges.targets.push_back(new_ids[edge.target]);
+        edges.probs.push_back(values[edge.id]);
+      }
+    }
+    LargeVector<unode_int> original_ids(order.size());
+    for (unode_int u = 0; u < order.size(); u++) {
+      original_ids[u] = original_id(order[u]);
+      new_ids[original_ids[u]] = u;
+    }
+    bool compressed = compressed_;
+    if (symmetric)
+      assign_undirected_edges(edges);
+    else
+      assign_edges(edges);
+    if (kind == PARAMETERS_FIXED)
+      params_.quantize();
+    else if (kind == PARAMETERS_DEGREE)
+      use_weighted_cascade();
+    else if (kind == PARAMETERS_CONSTANT)
+      use_constant_influence(constant);
+    if (compressed)
+      compress();
+    original_ids_.assign(std::move(original_ids));
+    internal_ids_.assign(std::move(new_ids));
+  }
+
+  /**
+    Id in the input of internal node `node` (see `reorder_nodes`).
+  */
+  unode_int original_id(unode_int node) const {
+    return (node < original_ids_.size()) ? original_ids_[node] : node;
+  }
+
+  /**
+    Internal id of node `node` of the input (see `reorder_nodes`). Ids that
+    are out of the graph are kept, so that they never collide with nodes.
+  */
+  unode_int internal_id(unode_int node) const {
+    return (node < internal_ids_.size()) ? internal_ids_[node] : node;
   }
 
+  /**
+    Replaces the graph by the edges of known influence in `edges`, directly in
+    the frozen layout: the compressed sparse row arrays are built by a parallel
+    counting sort, without going through the hash maps. The edges of a node
+    keep the order of `edges`, as with `add_edge` then `freeze`. By default
+    (`n_threads` = 0), the number of threads depends on the size of the graph.
+  */
+  void assign_edges(const EdgeList& edges, unsigned int n_threads = 0) {
+    *this = Graph();
+    size_t n_edges = edges.size();
+    // Histograms are per thread, small graphs are not worth it
+    if (n_threads == 0)
+      n_threads = std::min(hardware_threads(),
+                           (unsigned int)(n_edges >> 16) + 1);
+    std::vector<unode_int> max_ids(n_threads, 0);
+    parallel_chunks(n_edges, n_threads,
+        [&](unsigned int t, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++)
+            max_ids[t] = std::max(max_ids[t], std::max(edges.sources[i],
+                                                       edges.targets[i]) + 1);
+        });
+    unode_int n_ids = *std::max_element(max_ids.begin(), max_ids.end());
+    std::vector<uedge_int> positions(n_edges);  // Edge i is out_edges_[pos[i]]
+    counting_sort_csr(edges.sources, edges.targets, nullptr, n_ids, n_threads,
+                      out_offsets_, out_edges_, positions.data());
+    counting_sort_csr(edges.targets, edges.sources, positions.data(), n_ids,
+                      n_threads, in_offsets_, in_edges_, nullptr);
+    FlatArray<double> values;
+    values.assign(n_edges, 0.0);
+    double* vals = values.mutable_data();
+    parallel_chunks(n_edges, n_threads,
+        [&](unsigned int, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++)
+            vals[positions[i]] = edges.probs[i];
+        });
+    params_ = EdgeParameters::known_values(std::move(values));
+    // Nodes are the ones with at least one edge
+    node_bits_.assign((n_ids + 63) / 64, 0);
+    uint64_t* words = node_bits_.mutable_data();
+    std::vector<unode_int> counts(n_threads, 0);
+    parallel_chunks(node_bits_.size(), n_threads,
+        [&](unsigned int t, size_t begin, size_t end) {
+          for (unode_int u = begin * 64; u < std::min(end * 64, (size_t)n_ids);
+               u++) {
+            if (out_offsets_[u + 1] > out_offsets_[u]
+                || in_offsets_[u + 1] > in_offsets_[u]) {
+              words[u / 64] |= 1ULL << (u % 64);
+              counts[t]++;
+            }
+          }
+        });
+    for (auto count : counts)
+      num_nodes_ += count;
+    num_edges_ = n_edges;
+    frozen_ = true;
+  }
+
+  /**
+    Replaces the graph by the undirected edges of known influence in `edges`,
+    in a symmetric frozen layout: the list of node u holds all its neighbours
+    (sorted) and serves both `get_neighbours(u)` and `get_neighbours(u, true)`,
+    and the two directions of an edge share one id, so that its influence is
+    stored once. Compared to both directions in a directed graph, it halves
+    the memory of the adjacency and of the parameters. An edge given in both
+    directions (or several times) is kept once, with the first influence.
+    Graphs of known influence are then obtained from the graph as usual (see
+    `set_edge_parameters`). Modifying or compressing the graph converts it to
+    the directed layout first (see `compact`).
+  */
+  void assign_undirected_edges(const EdgeList& edges,
+                               unsigned int n_threads = 0) {
+    *this = Graph();
+    size_t n_edges = edges.size();
+    if (n_threads == 0)
+      n_threads = std::min(hardware_threads(),
+                           (unsigned int)(n_edges >> 16) + 1);
+    std::vector<unode_int> lows(n_edges), highs(n_edges);
+    std::vector<uedge_int> input_ids(n_edges);
+    std::vector<unode_int> max_ids(n_threads, 0);
+    parallel_chunks(n_edges, n_threads,
+        [&](unsigned int t, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) {
+            lows[i] = std::min(edges.sources[i], edges.targets[i]);
+            highs[i] = std::max(edges.sources[i], edges.targets[i]);
+            input_ids[i] = i;
+            max_ids[t] = std::max(max_ids[t], highs[i] + 1);
+          }
+        });
+    unode_int n_ids = *std::max_element(max_ids.begin(), max_ids.end());
+    // Edges by lower endpoint then higher endpoint, first occurrences first
+    FlatArray<uedge_int> offsets;
+    FlatArray<EdgeType> by_low;
+    counting_sort_csr(lows, highs, input_ids.data(), n_ids, n_threads,
+                      offsets, by_low, nullptr);
+    EdgeType* low_edges = by_low.mutable_data();
+    parallel_chunks(n_ids, n_threads,
+        [&](unsigned int, size_t begin, size_t end) {
+          std::stable_sort(low_edges + offsets[begin], low_edges + offsets[end],
+                           [](auto& e1, auto& e2) {
+                             return (e1.source < e2.source)
+                                 || (e1.source == e2.source
+                                     && e1.target < e2.target);
+                           });
+        });
+    // Each undirected edge k gets both directions, self loops one
+    std::vector<unode_int> keys, others;
+    std::vector<uedge_int> ids;
+    LargeVector<double> values;
+    for (uedge_int p = 0; p < n_edges; p++) {
+      const EdgeType& edge = low_edges[p];
+      if (p > 0 && edge.source == low_edges[p - 1].source
+          && edge.target == low_edges[p - 1].target)
+        continue;
+      uedge_int k = values.size();
+      values.push_back(edges.probs[edge.id]);
+      keys.push_back(edge.source);
+      others.push_back(edge.target);
+      ids.push_back(k);
+      if (edge.source != edge.target) {
+        keys.push_back(edge.target);
+        others.push_back(edge.source);
+        ids.push_back(k);
+      }
+    }
+    by_low.clear();
+    counting_sort_csr(keys, others, ids.data(), n_ids, n_threads, out_offsets_,
+                      out_edges_, nullptr);
+    EdgeType* out_edges = out_edges_.mutable_data();
+    parallel_chunks(n_ids, n_threads,
+        [&](unsigned int, size_t begin, size_t end) {
+          for (unode_int u = begin; u < end; u++)
+            std::sort(out_edges + out_offsets_[u],
+                      out_edges + out_offsets_[u + 1],
+                      [](auto& e1, auto& e2) { return e1.target < e2.target; });
+        });
+    in_offsets_ = out_offsets_;
+    in_edges_ = out_edges_;
+    FlatArray<double> known;
+    known.assign(std::move(values));
+    params_ = EdgeParameters::known_values(std::move(known));
+    node_bits_.assign((n_ids + 63) / 64, 0);
+    uint64_t* words = node_bits_.mutable_data();
+    for (unode_int u = 0; u < n_ids; u++) {
+      if (out_offsets_[u + 1] > out_offsets_[u]) {
+        words[u / 64] |= 1ULL << (u % 64);
+        num_nodes_++;
+      }
+    }
+    num_edges_ = out_edges_.size();
+    frozen_ = true;
+    symmetric_ = true;
+  }
+
+  bool is_frozen() const { return frozen_; }
+
+  bool is_symmetric() const { return symmetric_; }
+
   /**
     Sort edges of the graph such that for each node n, its list of neighbour
     edges is sorted from the lowest to the highest numbered. Used in PMCEvaluator.
   */
   void sort_edges() {
+    auto by_target = [](auto& e1, auto& e2) {
+      return (e1.target < e2.target);
+    };
+    if (symmetric_)  // Lists are already sorted by neighbour
+      return;
+    compact();
+    if (compressed_)  // Forward lists are already sorted by target
+      return;
     for (unsigned int i = 0; i < get_number_nodes(); i++) {
       if (!has_neighbours(i))
         continue;
-      auto& vec = adj_list_.find(i)->second;
-      sort(vec.begin(), vec.end(), [](auto& e1, auto& e2) {
-        return (e1.target < e2.target);
-      });
+      if (frozen_) {
+        EdgeType* edges = out_edges_.mutable_data();
+        std::sort(edges + out_offsets_[i], edges + out_offsets_[i + 1],
+                  by_target);
+      } else {
+        auto& vec = adj_list_.find(i)->second;
+        sort(vec.begin(), vec.end(), by_target);
+      }
     }
   }
 
@@ -123,9 +943,20 @@ class Graph {
     appearances in neighours' neighbours).
   */
   void remove_node(unode_int node) {
+    if (symmetric_)
+      compact();
     // 1. Remove node
-    node_set_.erase(node);
-    num_nodes_ = node_set_.size();
+    if (has_node(node)) {
+      node_bits_.mutable_data()[node / 64] &= ~(1ULL << (node % 64));
+      num_nodes_--;
+    }
+    if (frozen_) {  // Edges are deleted in the delta, in O(degree)
+      for (bool inv : {false, true})
+        for (auto& edge : get_neighbours(node, inv))
+          delete_edge(edge, inv);
+      compact_if_needed();
+      return;
+    }
     // 2. Remove real edges from `node`
     if (has_neighbours(node)) {
       std::vector<EdgeType>& neighbours = adj_list_[node];
@@ -139,6 +970,7 @@ class Graph {
           exit(1);
         }
         cur_inv_list.erase(it);
+        update_in_degree(edge.target);
       }
       adj_list_.erase(node);
     }
@@ -160,45 +992,207 @@ class Graph {
     }
   }
 
+  /**
+    Id of the first edge from `source` to `target` in the list of `source`,
+    or NO_EDGE if there is none. In a frozen graph, the targets of `source`
+    are binary searched in an index of the base (see `build_edge_index`), then
+    the delta is scanned. Building the index is not thread-safe.
+  */
+  uedge_int find_edge(unode_int source, unode_int target) const {
+    if (!frozen_) {
+      auto it = adj_list_.find(source);
+      if (it == adj_list_.end())
+        return NO_EDGE;
+      for (auto& edge : it->second)
+        if (edge.target == target)
+          return edge.id;
+      return NO_EDGE;
+    }
+    if (!indexed_)
+      build_edge_index();
+    if ((size_t)source + 1 < out_offsets_.size()) {
+      const unode_int* first = index_targets_.data() + out_offsets_[source];
+      const unode_int* last = index_targets_.data() + out_offsets_[source + 1];
+      for (auto it = std::lower_bound(first, last, target);
+           it != last && *it == target; ++it) {
+        uedge_int id = index_ids_[it - index_targets_.data()];
+        if (!is_deleted(id))
+          return id;
+      }
+    }
+    auto it = delta_out_.find(source);
+    if (it != delta_out_.end())
+      for (auto& edge : it->second)
+        if (edge.target == target && !is_deleted(edge.id))
+          return edge.id;
+    return NO_EDGE;
+  }
+
   void update_edge(unode_int src, unode_int tgt, unsigned int trial) {
-    if (adj_list_.find(src) != adj_list_.end()) {
-      for (EdgeType edge : adj_list_[src]) {
-        if (edge.target == tgt) {
-          edge.dist->update(trial, 1.0 - trial);
-          break;
-        }
+    uedge_int id = find_edge(src, tgt);
+    if (id != NO_EDGE) {
+      params_.update(id, trial, 1.0 - trial);
+      update_lt_distribution({tgt});
+    }
+  }
+
+  /**
+    Updates the parameters of the edges of all `trials` (see `update_edge`).
+    Trials are sorted by source and target, so that each edge is looked up
+    and updated once with its numbers of hits and misses. The LT distributions
+    of the targets are then rebuilt, if any.
+  */
+  void apply_trials(const std::vector<TrialType>& trials) {
+    std::vector<uint32_t> order(trials.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+      order[i] = i;
+    std::sort(order.begin(), order.end(), [&trials](uint32_t i, uint32_t j) {
+      return (trials[i].source < trials[j].source)
+          || (trials[i].source == trials[j].source
+              && trials[i].target < trials[j].target);
+    });
+    for (size_t i = 0; i < order.size();) {
+      const TrialType& tt = trials[order[i]];
+      unode_int hits = 0, misses = 0;
+      for (; i < order.size() && trials[order[i]].source == tt.source
+             && trials[order[i]].target == tt.target; i++) {
+        if (trials[order[i]].trial == 1)
+          hits++;
+        else
+          misses++;
       }
+      uedge_int id = find_edge(tt.source, tt.target);
+      if (id != NO_EDGE)
+        params_.update(id, hits, misses);
     }
+    if (lt_offsets_.empty())
+      return;
+    std::vector<unode_int> targets;
+    for (auto& tt : trials)
+      targets.push_back(tt.target);
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    update_lt_distribution(targets);
   }
 
   void update_edge_priors(double alpha, double beta) {
     set_prior(alpha, beta);
-    for (auto lst : adj_list_)
-      for (auto edge : lst.second) {
-        edge.dist->update_prior(alpha, beta);
-      }
+    params_.update_prior(alpha, beta);
+    if (!lt_offsets_.empty())  // All the weights have changed
+      build_lt_distribution(lt_type_);
   }
 
   double get_mse() {
     double edges = 0.0;
     double tse = 0.0;
-    for (auto lst : adj_list_)
-      for (auto edge : lst.second) {
-        edges += 1.0;
-        tse += edge.dist->sq_error();
-      }
+    for_each_edge([this, &edges, &tse](const EdgeType& edge) {
+      edges += 1.0;
+      tse += params_.sq_error(edge.id, edge.target);
+    });
     return tse / edges;
   }
 
   void update_rounds(double round) {
-    for (auto lst : adj_list_) {
-      for (auto edge : lst.second) {
-        edge.dist->set_round(round);
-      }
+    params_.set_round(round);
+  }
+
+  /**
+    Influence parameters of the edges, indexed by `EdgeType::id`. Samplers
+    should keep a reference on it rather than calling `get_influence` in their
+    inner loops.
+  */
+  const EdgeParameters& get_edge_parameters() const {
+    return params_;
+  }
+
+  /**
+    Influence of `edge` (reversed if `inv`) for the given type (see
+    `InfluenceDistribution::sample`).
+  */
+  double get_influence(const EdgeType& edge, unsigned int type,
+                       bool inv=false) const {
+    return params_.sample(edge.id, edge.head(inv), type);
+  }
+
+  /**
+    Known influence values of the edges, by edge id, including the ones
+    computed by weight models.
+  */
+  FlatArray<double> get_known_values() const {
+    int kind = params_.get_kind();
+    if (kind != PARAMETERS_CONSTANT && kind != PARAMETERS_DEGREE)
+      return params_.get_values();
+    FlatArray<double> values;
+    values.assign(params_.size(), 0.0);
+    double* vals = values.mutable_data();
+    for_each_edge([this, vals](const EdgeType& edge) {
+      vals[edge.id] = params_.mean(edge.id, edge.target);
+    });
+    return values;
+  }
+
+  /**
+    Replaces the influence of edges by the weighted cascade model, whose
+    influence 1 / indeg(v) on the edges entering v are also the weights of the
+    uniform LT model. They are computed from the in-degrees of nodes, without
+    storing edge probabilities (see `EdgeParameters::weighted_cascade`). The
+    graph must be frozen.
+  */
+  void use_weighted_cascade() {
+    unode_int n_ids = 0;
+    for (auto node : get_nodes())
+      n_ids = node + 1;
+    FlatArray<uedge_int> in_degree;
+    in_degree.assign(n_ids, 0);
+    uedge_int* degrees = in_degree.mutable_data();
+    for (auto node : get_nodes())
+      degrees[node] = get_neighbours(node, true).size();
+    set_edge_parameters(EdgeParameters::weighted_cascade(
+        params_.size(), std::move(in_degree)));
+  }
+
+  /**
+    Replaces the influence of edges by the constant `prob`, which is not stored
+    by edge (see `EdgeParameters::constant`). The graph must be frozen.
+  */
+  void use_constant_influence(double prob) {
+    set_edge_parameters(EdgeParameters::constant(params_.size(), prob));
+  }
+
+  /**
+    Stores the known influence of edges in fixed point (see
+    `EdgeParameters::quantize`).
+  */
+  void quantize() {
+    params_.quantize();
+  }
+
+  /**
+    Replaces the influence parameters of all edges, e.g. to get a model graph
+    from a graph of known influence probabilities. The graph must be frozen.
+    A copy of a frozen graph shares its topology, so that graphs differing
+    only by their weights (original, model and constant graphs) cost one
+    weight layer each. LT distributions are rebuilt, if any.
+  */
+  void set_edge_parameters(EdgeParameters params) {
+    if (!frozen_ || params.size() != params_.size()) {
+      std::cerr << "Error: edge parameters do not match the graph."
+                << std::endl;
+      exit(1);
     }
+    params_ = std::move(params);
+    if (!lt_offsets_.empty())
+      build_lt_distribution(lt_type_);
   }
 
   bool has_neighbours(unode_int node, bool inv=false) const {
+    if (frozen_) {
+      if (delta_size_ > 0)
+        return get_neighbours(node, inv).size() > 0;
+      const FlatArray<uedge_int>& offsets = inv ? in_offsets_ : out_offsets_;
+      return (size_t)node + 1 < offsets.size()
+          && offsets[node + 1] > offsets[node];
+    }
     if (!inv)
       return adj_list_.find(node) != adj_list_.end();
     else
@@ -207,28 +1201,55 @@ class Graph {
 
   /**
     Get the list of neighbours for the `node` given in parameter. To obtain the
-    reversed neighbors for TIM-like algorithms, set inv to `true`.
+    reversed neighbors for TIM-like algorithms, set inv to `true`. The range is
+    empty if `node` has no neighbours.
   */
-  const std::vector<EdgeType>& get_neighbours(
-      unode_int node, bool inv=false) const {
-    if (!inv)
-      return (adj_list_.find(node))->second;
-    else
-      return (inv_adj_list_.find(node))->second;
+  EdgeRange get_neighbours(unode_int node, bool inv=false) const {
+    if (frozen_) {
+      EdgeRange range = get_base_neighbours(node, inv);
+      if (delta_size_ == 0)
+        return range;
+      // Merged view of the base and the delta
+      const auto& delta = inv ? delta_in_ : delta_out_;
+      const auto& deleted = inv ? deleted_in_ : deleted_out_;
+      auto it = delta.find(node);
+      const EdgeType* extra = (it != delta.end()) ? it->second.data() : nullptr;
+      size_t extra_size = (it != delta.end()) ? it->second.size() : 0;
+      auto del = deleted.find(node);
+      size_t size = range.size() + extra_size
+          - ((del != deleted.end()) ? del->second : 0);
+      range.set_delta(extra, extra_size,
+                      deleted_.empty() ? nullptr : deleted_.data(), size);
+      return range;
+    }
+    auto& lists = inv ? inv_adj_list_ : adj_list_;
+    auto it = lists.find(node);
+    if (it == lists.end())
+      return EdgeRange();
+    return EdgeRange(it->second.data(),
+                     it->second.data() + it->second.size());
   };
 
   /**
-    Get the set of nodes.
+    Get the set of nodes (by increasing ids).
   */
-  const std::unordered_set<unode_int>& get_nodes() const {
-    return node_set_;
+  NodeRange get_nodes() const {
+    return NodeRange(node_bits_.data(), node_bits_.size());
   }
 
   /**
     Test if a node is in the graph.
   */
-  bool has_node(unode_int node) {
-    return node_set_.find(node) != node_set_.end();
+  bool has_node(unode_int node) const {
+    return node / 64 < node_bits_.size()
+        && (node_bits_[node / 64] & (1ULL << (node % 64))) != 0;
+  }
+
+  /**
+    Upper bound on the ids of the nodes, to size arrays indexed by node.
+  */
+  unode_int get_id_bound() const {
+    return node_bits_.size() * 64;
   }
 
   /**
@@ -247,27 +1268,46 @@ class Graph {
 
   /**
     Build the distribution on each node to sample incoming living edges for the
-    LT model. It requires the graph has been entirely loaded. This method can
-    also be called after an update of weight estimations.
+    LT model. It requires the graph has been entirely loaded. Distributions are
+    Walker alias tables in flat arrays, sampled in O(1) by
+    `sample_living_edge`. After an update of weight estimations, only the
+    nodes whose incoming weights changed need to be rebuilt (see
+    `update_lt_distribution`), the structure of the graph being the same.
   */
   void build_lt_distribution(unsigned int type) {
-    for (unode_int u = 0; u < num_nodes_; u++) {
-      if (has_neighbours(u, true)) {  // Only reversed edges are interesting
-        auto& neighbours = get_neighbours(u, true);
-        std::vector<double> w(neighbours.size() + 1, 0);
-        double total = 0;
-        for (unsigned int i = 0; i < neighbours.size(); i++) {
-          double cur_weight = neighbours[i].dist->sample(type);
-          total += cur_weight;
-          w[i] = cur_weight;
-        }
-        if (total < 1) {  // Weights do not sum to 1, we can sample no edge
-          w[neighbours.size()] = 1 - total;
-        }
-        // Note, the UCB-like case is handled automatically by discrete_distribution
-        // because one can have weights > 1
-        lt_dist_[u] = std::discrete_distribution<>(w.begin(), w.end());
+    unode_int n_ids = 0;
+    for (auto node : get_nodes())
+      n_ids = node + 1;
+    LargeVector<uedge_int> offsets(n_ids + 1, 0);
+    for (unode_int u = 0; u < n_ids; u++) {
+      uedge_int degree = get_neighbours(u, true).size();
+      offsets[u + 1] = offsets[u] + ((degree > 0) ? degree + 1 : 0);
+    }
+    lt_threshold_.assign(offsets[n_ids], 0);
+    lt_alias_.assign(offsets[n_ids], 0);
+    lt_offsets_.assign(std::move(offsets));
+    lt_type_ = type;
+    for (unode_int u = 0; u < n_ids; u++)
+      build_alias_table(u);
+  }
+
+  /**
+    Rebuilds the LT distributions of `nodes` only, after an update of the
+    weights of their incoming edges. Nothing is done if the distributions were
+    not built.
+  */
+  void update_lt_distribution(const std::vector<unode_int>& nodes) {
+    if (lt_offsets_.empty())
+      return;
+    for (auto node : nodes) {
+      uedge_int degree = get_neighbours(node, true).size();
+      if ((size_t)node + 1 >= lt_offsets_.size()
+          || lt_offsets_[node + 1] - lt_offsets_[node]
+             != ((degree > 0) ? degree + 1 : 0)) {
+        build_lt_distribution(lt_type_);  // The structure has changed
+        return;
       }
+      build_alias_table(node);
     }
   }
 
@@ -278,14 +1318,47 @@ class Graph {
     sample.
   */
   int sample_living_edge(unode_int node, boost::mt19937& gen) const {
-    if (has_neighbours(node, true)) {
-      int index = lt_dist_[node](gen);
-      if (index < (int)get_neighbours(node, true).size())
-        return index;
-    }
+    if ((size_t)node + 1 >= lt_offsets_.size())
+      return -1;
+    uedge_int first = lt_offsets_[node];
+    uedge_int n_slots = lt_offsets_[node + 1] - first;
+    if (n_slots == 0)
+      return -1;
+    uint32_t slot = ((uint64_t)(uint32_t)gen() * n_slots) >> 32;
+    if ((uint32_t)gen() >= lt_threshold_[first + slot])
+      slot = lt_alias_[first + slot];
+    if (slot + 1 < n_slots && slot < get_neighbours(node, true).size())
+      return slot;
     return -1;
   }
 
+  /**
+    Draws the live edges leaving `node` (entering it if `inv`) with their
+    influence for the given type, and calls `live(edge)` for each of them.
+    Plain lists are drawn by blocks of 64 edges from the random values of
+    `rng` (Xoshiro, see `EdgeParameters::live_edges`), other lists edge by
+    edge.
+  */
+  template<typename RNG, typename Live>
+  void draw_live_edges(unode_int node, unsigned int type, RNG& rng, Live live,
+                       bool inv=false) const {
+    EdgeRange edges = get_neighbours(node, inv);
+    const EdgeType* plain = edges.data();
+    if (plain == nullptr) {
+      for (auto& edge : edges)
+        if (params_.sample_live(edge.id, edge.head(inv), type, rng))
+          live(edge);
+      return;
+    }
+    size_t degree = edges.size();
+    for (size_t i = 0; i < degree; i += 64) {
+      unsigned int n = (unsigned int)std::min<size_t>(64, degree - i);
+      for (uint64_t mask = params_.live_edges(plain + i, n, inv, type, rng);
+           mask != 0; mask &= mask - 1)
+        live(plain[i + __builtin_ctzll(mask)]);
+    }
+  }
+
   /**
     Display graph edges for debug purposes.
   */
@@ -294,8 +1367,455 @@ class Graph {
       if (!has_neighbours(i))
         continue;
       for (auto& edge : get_neighbours(i))
-        std::cerr << edge.source << "\t" << edge.target << "\t" << edge.dist->sample(type) << std::endl;
+        std::cerr << edge.source << "\t" << edge.target << "\t" << params_.sample(edge.id, edge.target, type) << std::endl;
+    }
+  }
+
+  /**
+    Saves the graph in a binary file, which can then be loaded instantly with
+    `load_binary`. Only frozen graphs of known influence probabilities can be
+    saved.
+  */
+  void save_binary(const std::string& filename) const {
+    if (compressed_ || delta_size_ > 0) {
+      Graph graph(*this);
+      graph.compact();
+      graph.decompress();
+      graph.save_binary(filename);
+      return;
+    }
+    if (!frozen_ || params_.get_kind() == PARAMETERS_BETA) {
+      std::cerr << "Error: only frozen graphs of known influence can be saved."
+                << std::endl;
+      exit(1);
+    }
+    BinaryGraphHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic));
+    header.version = BINARY_GRAPH_VERSION;
+    header.node_size = sizeof(unode_int);
+    header.offset_size = sizeof(uedge_int);
+    header.edge_size = sizeof(EdgeType);
+    header.flags = symmetric_ ? BINARY_GRAPH_SYMMETRIC : 0;
+    header.n_nodes = num_nodes_;
+    header.n_edges = num_edges_;
+    FlatArray<double> values = get_known_values();
+    const char* data[BINARY_GRAPH_SECTIONS] = {
+        (const char*)node_bits_.data(), (const char*)out_offsets_.data(),
+        (const char*)out_edges_.data(), (const char*)in_offsets_.data(),
+        (const char*)in_edges_.data(), (const char*)values.data(),
+        (const char*)original_ids_.data()};
+    size_t sizes[BINARY_GRAPH_SECTIONS] = {
+        node_bits_.size(), out_offsets_.size(), out_edges_.size(),
+        symmetric_ ? 0 : in_offsets_.size(), symmetric_ ? 0 : in_edges_.size(),
+        values.size(), original_ids_.size()};
+    size_t bytes[BINARY_GRAPH_SECTIONS] = {
+        sizeof(uint64_t), sizeof(uedge_int), sizeof(EdgeType),
+        sizeof(uedge_int), sizeof(EdgeType), sizeof(double),
+        sizeof(unode_int)};
+    uint64_t pos = sizeof(header);
+    for (int i = 0; i < BINARY_GRAPH_SECTIONS; i++) {
+      pos = (pos + BINARY_GRAPH_ALIGN - 1) / BINARY_GRAPH_ALIGN
+          * BINARY_GRAPH_ALIGN;
+      header.pos[i] = pos;
+      header.size[i] = sizes[i];
+      pos += sizes[i] * bytes[i];
+    }
+    std::ofstream file(filename, std::ios::binary);
+    file.write((const char*)&header, sizeof(header));
+    pos = sizeof(header);
+    for (int i = 0; i < BINARY_GRAPH_SECTIONS; i++) {
+      for (; pos < header.pos[i]; pos++)
+        file.put(0);
+      file.write(data[i], sizes[i] * bytes[i]);
+      pos += sizes[i] * bytes[i];
+    }
+    if (!file) {
+      std::cerr << "Error: cannot write " << filename << std::endl;
+      exit(1);
+    }
+  }
+
+  /**
+    Loads a graph saved by `save_binary`. The file is memory-mapped and its
+    arrays are used in place (they are copied only if the graph is modified).
+  */
+  void load_binary(const std::string& filename) {
+    auto file = std::make_shared<const MappedFile>(filename);
+    BinaryGraphHeader header;
+    if (file->size() < sizeof(header)) {
+      std::cerr << "Error: " << filename << " is not a binary graph."
+                << std::endl;
+      exit(1);
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic))
+        || header.version != BINARY_GRAPH_VERSION
+        || header.node_size != sizeof(unode_int)
+        || header.offset_size != sizeof(uedge_int)
+        || header.edge_size != sizeof(EdgeType)) {
+      std::cerr << "Error: " << filename << " is not a binary graph of this "
+                << "version of oim." << std::endl;
+      exit(1);
+    }
+    *this = Graph();
+    node_bits_.map(file, header.pos[0], header.size[0]);
+    out_offsets_.map(file, header.pos[1], header.size[1]);
+    out_edges_.map(file, header.pos[2], header.size[2]);
+    in_offsets_.map(file, header.pos[3], header.size[3]);
+    in_edges_.map(file, header.pos[4], header.size[4]);
+    params_.map_values(file, header.pos[5], header.size[5]);
+    original_ids_.map(file, header.pos[6], header.size[6]);
+    if (header.flags & BINARY_GRAPH_SYMMETRIC) {
+      in_offsets_ = out_offsets_;
+      in_edges_ = out_edges_;
+      symmetric_ = true;
+    }
+    if (!original_ids_.empty()) {
+      LargeVector<unode_int> internal_ids(original_ids_.size());
+      for (unode_int u = 0; u < original_ids_.size(); u++)
+        internal_ids[original_ids_[u]] = u;
+      internal_ids_.assign(std::move(internal_ids));
+    }
+    num_nodes_ = header.n_nodes;
+    num_edges_ = header.n_edges;
+    frozen_ = true;
+  }
+
+  /**
+    Tests whether `filename` is a graph saved by `save_binary`.
+  */
+  static bool is_binary_file(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[8];
+    return file.read(magic, sizeof(magic))
+        && std::memcmp(magic, BINARY_GRAPH_MAGIC, sizeof(magic)) == 0;
+  }
+
+ private:
+  void insert_edge(unode_int source, unode_int target, uedge_int id) {
+    add_node(source);
+    add_node(target);
+    num_edges_++;
+    if (frozen_) {
+      delta_out_[source].push_back(EdgeType(source, target, id));
+      delta_in_[target].push_back(EdgeType(target, source, id));
+      if (!deleted_.empty() && id / 64 >= deleted_.size())
+        deleted_.resize(id / 64 + 1, 0);
+      delta_size_++;
+      update_in_degree(target);
+      compact_if_needed();
+      return;
+    }
+    adj_list_[source].push_back(EdgeType(source, target, id));
+    inv_adj_list_[target].push_back(EdgeType(target, source, id));
+    update_in_degree(target);
+  }
+
+  /**
+    Updates the in-degree of `node` in the weighted cascade model, if used.
+  */
+  void update_in_degree(unode_int node) {
+    if (params_.get_kind() == PARAMETERS_DEGREE)
+      params_.set_in_degree(node, get_neighbours(node, true).size());
+  }
+
+  /**
+    Deletes `edge` of a frozen graph in the delta (`edge` is reversed if
+    `inv`).
+  */
+  void delete_edge(const EdgeType& edge, bool inv=false) {
+    if (deleted_.empty())
+      deleted_.assign(params_.size() / 64 + 1, 0);
+    deleted_.mutable_data()[edge.id / 64] |= 1ULL << (edge.id % 64);
+    deleted_out_[inv ? edge.target : edge.source]++;
+    deleted_in_[edge.head(inv)]++;
+    num_edges_--;
+    delta_size_++;
+    update_in_degree(edge.head(inv));
+  }
+
+  /**
+    Merges the delta in the base when it gets large compared to the base, so
+    that the overhead of the merged view stays small.
+  */
+  void compact_if_needed() {
+    uedge_int base_size =
+        out_offsets_.empty() ? 0 : out_offsets_[out_offsets_.size() - 1];
+    if (delta_size_ > base_size / 8 + 1024)
+      compact();
+  }
+
+  /**
+    Builds the alias table of the incoming edges of `node` in its slots (see
+    `lt_offsets_`) by Vose's method. Weights are the influence of the edges,
+    and the last slot has weight 1 - total if the total is below 1, so that
+    no edge is sampled then (as weights can exceed 1 for UCB-like types, they
+    are normalized).
+  */
+  void build_alias_table(unode_int node) {
+    uedge_int first = lt_offsets_[node];
+    uedge_int n_slots = lt_offsets_[node + 1] - first;
+    if (n_slots == 0)
+      return;
+    std::vector<double> w(n_slots, 0);
+    double total = 0;
+    unsigned int i = 0;
+    for (auto& edge : get_neighbours(node, true)) {
+      w[i] = params_.sample(edge.id, node, lt_type_);
+      total += w[i++];
+    }
+    w[n_slots - 1] = (total < 1) ? 1 - total : 0;
+    double sum = std::max(total, 1.0);
+    std::vector<uint32_t> small, large;
+    for (i = 0; i < n_slots; i++) {
+      w[i] *= n_slots / sum;
+      (w[i] < 1 ? small : large).push_back(i);
+    }
+    uint32_t* threshold = lt_threshold_.mutable_data() + first;
+    uint32_t* alias = lt_alias_.mutable_data() + first;
+    while (!small.empty() && !large.empty()) {
+      uint32_t s = small.back(), l = large.back();
+      small.pop_back();
+      threshold[s] = (uint32_t)(w[s] * FIXED_POINT_ONE);
+      alias[s] = l;
+      w[l] -= 1 - w[s];
+      if (w[l] < 1) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    for (auto l : large) {
+      threshold[l] = UINT32_MAX;
+      alias[l] = l;
+    }
+    for (auto s : small) {  // Rounding errors
+      threshold[s] = UINT32_MAX;
+      alias[s] = s;
+    }
+  }
+
+  bool is_deleted(uedge_int id) const {
+    return !deleted_.empty() && (deleted_[id / 64] >> (id % 64)) & 1;
+  }
+
+  /**
+    Builds the index of `find_edge`: the edges of each node of the base are
+    stably sorted by target, so that the first match keeps the order of the
+    list.
+  */
+  void build_edge_index() const {
+    unode_int n_ids = out_offsets_.empty() ? 0 : out_offsets_.size() - 1;
+    uedge_int n_edges = out_offsets_.empty() ? 0 : out_offsets_[n_ids];
+    LargeVector<unode_int> targets(n_edges);
+    LargeVector<uedge_int> ids(n_edges);
+    parallel_chunks(n_ids, std::min(hardware_threads(),
+                                    (unsigned int)(n_edges >> 16) + 1),
+        [&](unsigned int, size_t begin, size_t end) {
+          std::vector<EdgeType> lst;
+          for (unode_int u = begin; u < end; u++) {
+            lst.clear();
+            for (auto& edge : get_base_neighbours(u, false))
+              lst.push_back(edge);
+            std::stable_sort(lst.begin(), lst.end(), [](auto& e1, auto& e2) {
+              return e1.target < e2.target;
+            });
+            uedge_int i = out_offsets_[u];
+            for (auto& edge : lst) {
+              targets[i] = edge.target;
+              ids[i++] = edge.id;
+            }
+          }
+        });
+    index_targets_.assign(std::move(targets));
+    index_ids_.assign(std::move(ids));
+    indexed_ = true;
+  }
+
+  void clear_edge_index() {
+    index_targets_.clear();
+    index_ids_.clear();
+    indexed_ = false;
+  }
+
+  /**
+    Edges of `node` in the frozen base, without the delta.
+  */
+  EdgeRange get_base_neighbours(unode_int node, bool inv) const {
+    const FlatArray<uedge_int>& offsets = inv ? in_offsets_ : out_offsets_;
+    if ((size_t)node + 1 >= offsets.size())
+      return EdgeRange();
+    if (compressed_) {
+      const uint8_t* bytes = inv ? in_bytes_.data() + in_pos_[node]
+                                 : out_bytes_.data() + out_pos_[node];
+      return EdgeRange(bytes, offsets[node + 1] - offsets[node], node,
+                       offsets[node], inv ? out_offsets_.data() : nullptr);
+    }
+    const EdgeType* edges = inv ? in_edges_.data() : out_edges_.data();
+    return EdgeRange(edges + offsets[node], edges + offsets[node + 1]);
+  }
+
+  /**
+    Applies `f` on each edge of the graph (the reversed ones excepted).
+  */
+  template<typename F>
+  void for_each_edge(F f) const {
+    if (frozen_) {
+      for (auto u : get_nodes())
+        for (auto& edge : get_neighbours(u))
+          f(edge);
+    } else {
+      for (auto& lst : adj_list_)
+        for (auto& edge : lst.second)
+          f(edge);
+    }
+  }
+
+  /**
+    Order of the nodes for `reorder_nodes` (order[i] is the old id of the new
+    node i).
+  */
+  std::vector<unode_int> locality_order() const {
+    unode_int n_ids = out_offsets_.size() - 1;
+    auto degree = [this](unode_int u) {
+      return out_offsets_[u + 1] - out_offsets_[u]
+          + in_offsets_[u + 1] - in_offsets_[u];
+    };
+    std::vector<unode_int> starts;
+    for (auto u : get_nodes())
+      starts.push_back(u);
+    std::stable_sort(starts.begin(), starts.end(),
+                     [&degree](unode_int u, unode_int v) {
+                       return degree(u) > degree(v);
+                     });
+    std::vector<unode_int> order;
+    order.reserve(n_ids);
+    std::vector<bool> visited(n_ids, false);
+    for (auto start : starts) {
+      if (visited[start])
+        continue;
+      visited[start] = true;
+      order.push_back(start);
+      for (size_t head = order.size() - 1; head < order.size(); head++) {
+        for (bool inv : {false, true}) {
+          for (auto& edge : get_neighbours(order[head], inv)) {
+            if (!visited[edge.target]) {
+              visited[edge.target] = true;
+              order.push_back(edge.target);
+            }
+          }
+        }
+      }
+    }
+    for (unode_int u = 0; u < n_ids; u++)
+      if (!visited[u])
+        order.push_back(u);
+    return order;
+  }
+
+  /**
+    Renumbers edges following the forward layout, so that parameters of the
+    edges of a node are contiguous too (edge i is then out_edges_[i]).
+  */
+  void renumber_edges() {
+    std::vector<uedge_int> order(out_edges_.size());
+    std::vector<uedge_int> new_ids(params_.size());
+    EdgeType* out_edges = out_edges_.mutable_data();
+    for (uedge_int i = 0; i < out_edges_.size(); i++) {
+      order[i] = out_edges[i].id;
+      new_ids[out_edges[i].id] = i;
+      out_edges[i].id = i;
+    }
+    EdgeType* in_edges = in_edges_.mutable_data();
+    for (uedge_int i = 0; i < in_edges_.size(); i++)
+      in_edges[i].id = new_ids[in_edges[i].id];
+    params_.permute(order);
+  }
+
+  /**
+    Builds the compressed sparse row arrays of the edges (keys[i], others[i])
+    by a stable counting sort on keys. Each thread counts the keys of its chunk
+    of edges, then writes them from its own start offset for each key. Edge ids
+    are `ids[i]`, or the position of the edge if `ids` is null (then written in
+    `positions`).
+  */
+  static void counting_sort_csr(
+      const std::vector<unode_int>& keys, const std::vector<unode_int>& others,
+      const uedge_int* ids, unode_int n_ids, unsigned int n_threads,
+      FlatArray<uedge_int>& offsets, FlatArray<EdgeType>& edges,
+      uedge_int* positions) {
+    size_t n_edges = keys.size();
+    std::vector<std::vector<uedge_int>> starts(n_threads);
+    parallel_chunks(n_edges, n_threads,
+        [&](unsigned int t, size_t begin, size_t end) {
+          starts[t].assign(n_ids, 0);
+          for (size_t i = begin; i < end; i++)
+            starts[t][keys[i]]++;
+        });
+    offsets.assign(n_ids + 1, 0);
+    uedge_int* offs = offsets.mutable_data();
+    uedge_int pos = 0;
+    for (unode_int u = 0; u < n_ids; u++) {
+      offs[u] = pos;
+      for (unsigned int t = 0; t < n_threads; t++) {
+        uedge_int count = starts[t][u];
+        starts[t][u] = pos;
+        pos += count;
+      }
+    }
+    offs[n_ids] = pos;
+    edges.assign(n_edges, EdgeType(0, 0, 0));
+    EdgeType* out = edges.mutable_data();
+    parallel_chunks(n_edges, n_threads,
+        [&](unsigned int t, size_t begin, size_t end) {
+          std::vector<uedge_int>& start = starts[t];
+          for (size_t i = begin; i < end; i++) {
+            uedge_int p = start[keys[i]]++;
+            out[p] = EdgeType(keys[i], others[i], ids ? ids[i] : p);
+            if (positions)
+              positions[i] = p;
+          }
+        });
+  }
+
+  /**
+    Packs the lists of edges in a single array `edges` such that the edges of
+    node u are found between `offsets[u]` and `offsets[u + 1]`.
+  */
+  static void build_csr(
+      const std::unordered_map<unode_int, std::vector<EdgeType>>& lists,
+      unode_int n_ids, FlatArray<uedge_int>& offsets,
+      FlatArray<EdgeType>& edges) {
+    offsets.assign(n_ids + 1, 0);
+    uedge_int* offs = offsets.mutable_data();
+    for (auto& lst : lists)
+      offs[lst.first + 1] = lst.second.size();
+    for (unode_int u = 0; u < n_ids; u++)
+      offs[u + 1] += offs[u];
+    edges.clear();
+    edges.reserve(offs[n_ids]);
+    for (unode_int u = 0; u < n_ids; u++) {
+      auto it = lists.find(u);
+      if (it != lists.end())
+        edges.append(it->second.begin(), it->second.end());
+    }
+  }
+
+  /**
+    Inverse of `build_csr`: unpacks the edges in per-node lists and releases the
+    arrays.
+  */
+  static void expand_csr(
+      FlatArray<uedge_int>& offsets, FlatArray<EdgeType>& edges,
+      std::unordered_map<unode_int, std::vector<EdgeType>>& lists) {
+    lists.clear();
+    for (unode_int u = 0; u + 1 < offsets.size(); u++) {
+      if (offsets[u + 1] > offsets[u])
+        lists[u] = std::vector<EdgeType>(edges.begin() + offsets[u],
+                                         edges.begin() + offsets[u + 1]);
     }
+    offsets.clear();
+    edges.clear();
   }
 };
 
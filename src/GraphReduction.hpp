@@ -23,8 +23,10 @@
 #ifndef __oim__GraphReduction__
 #define __oim__GraphReduction__
 
+#include <queue>
 #include <unordered_set>
 #include "Graph.hpp"
+#include "GraphView.hpp"
 #include "Evaluator.hpp"
 #include "SpreadSampler.hpp"
 #include "SingleInfluence.hpp"
@@ -55,16 +57,12 @@ class EvaluatorReduction : public GraphReduction {
 
   std::vector<unode_int> extractExperts(
       const Graph& graph, int n_experts) {
-    // 1. Copy graph assigning probability `p_` on every edge
-    Graph model_graph;
-    for (unode_int i = 0; i < graph.get_number_nodes(); i++) {
-      if (!graph.has_neighbours(i))
-        continue;
-      for (auto& edge : graph.get_neighbours(i)) {
-        std::shared_ptr<InfluenceDistribution> dst(new SingleInfluence(p_));
-        model_graph.add_edge(edge.source, edge.target, dst);
-      }
-    }
+    // 1. Copy graph assigning probability `p_` on every edge (the topology
+    // is shared)
+    Graph model_graph(graph);
+    model_graph.freeze();
+    model_graph.set_edge_parameters(EdgeParameters::constant(
+        model_graph.get_edge_parameters().size(), p_));
     // 2. Select experts using the evaluator
     SpreadSampler sampler(INFLUENCE_MED, model_);
     std::unordered_set<unode_int> activated;
@@ -112,15 +110,13 @@ class GreedyMaxCoveringReduction : public GraphReduction {
  public:
   std::vector<unode_int> extractExperts(const Graph& graph, int n_experts) {
     std::vector<unode_int> result(n_experts, 0);
-    Graph copy_graph(graph); // Copy the graph
+    GraphView view(graph); // Nodes are removed from the view only
     for (int i = 0; i < n_experts; i++) {
       // 1. Pick the node with highest degree
       unode_int current_node = 0; // Current picked node
       unsigned int current_value = 0; // Number of neighbours for current node
-      for (auto& node : copy_graph.get_nodes()) {
-        if (!copy_graph.has_neighbours(node))
-          continue;
-        unsigned int value = copy_graph.get_neighbours(node).size();
+      for (auto node : view.get_nodes()) {
+        unsigned int value = view.get_degree(node);
         if (value > current_value) {
           current_value = value;
           current_node = node;
@@ -129,7 +125,7 @@ class GreedyMaxCoveringReduction : public GraphReduction {
       // Add the node the the result
       result[i] = current_node;
       // 2. Remove all neighbours of chosen node
-      copy_graph.remove_node(current_node);
+      view.remove_node(current_node);
     }
     return result;
   }
@@ -178,16 +174,12 @@ class DivRankReduction : public GraphReduction {
       : alpha_(alpha), p_(p), n_iter_(n_iter) {}
 
   std::vector<unode_int> extractExperts(const Graph& graph, int n_experts) {
-    // 1. Copy graph assigning probability `p_` on every edge
-    Graph model_graph;
-    for (unode_int i = 0; i < graph.get_number_nodes(); i++) {
-      if (!graph.has_neighbours(i))
-        continue;
-      for (auto& edge : graph.get_neighbours(i)) {
-        std::shared_ptr<InfluenceDistribution> dst(new SingleInfluence(p_));
-        model_graph.add_edge(edge.source, edge.target, dst);
-      }
-    }
+    // 1. Copy graph assigning probability `p_` on every edge (the topology
+    // is shared)
+    Graph model_graph(graph);
+    model_graph.freeze();
+    model_graph.set_edge_parameters(EdgeParameters::constant(
+        model_graph.get_edge_parameters().size(), p_));
     // 2. DivRank on the model graph.
     unode_int n = model_graph.get_number_nodes();
     std::vector<double> pi(n, 1. / n);
@@ -0,0 +1,180 @@
+/*
+ Copyright (c) 2015-2017 Paul Lagrée, Siyu Lei, Silviu Maniu, Luyi Mo
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#ifndef __oim__GraphView__
+#define __oim__GraphView__
+
+#include <vector>
+
+#include "common.hpp"
+#include "Graph.hpp"
+
+/**
+  View on a graph from which nodes can be removed without copying nor modifying
+  the graph: removed nodes are unset in a bitmap of alive nodes, and the degrees
+  of their neighbours are decremented. Removing a node costs O(degree). Edges
+  are those of the graph whose endpoints are both alive. The graph must outlive
+  the view and must not be modified while the view is used.
+*/
+class GraphView {
+ private:
+  const Graph& graph_;
+  std::vector<uint64_t> alive_;  // Bitmap of alive nodes
+  std::vector<uedge_int> out_degree_;  // Numbers of live edges of nodes
+  std::vector<uedge_int> in_degree_;
+  unode_int num_nodes_ = 0;
+  uedge_int num_edges_ = 0;
+
+ public:
+  /**
+    Edges of a node whose target is alive, as returned by `get_neighbours`.
+  */
+  class AliveEdgeRange {
+   private:
+    EdgeRange edges_;
+    const GraphView* view_;
+    size_t size_;
+
+   public:
+    class iterator {
+     private:
+      EdgeRange::iterator it_;
+      EdgeRange::iterator end_;
+      const GraphView* view_;
+
+      void skip_dead() {
+        while (it_ != end_ && !view_->has_node(it_->target))
+          ++it_;
+      }
+
+     public:
+      iterator(EdgeRange::iterator it, EdgeRange::iterator end,
+               const GraphView* view)
+          : it_(it), end_(end), view_(view) { skip_dead(); }
+
+      const EdgeType& operator*() const { return *it_; }
+
+      const EdgeType* operator->() const { return &*it_; }
+
+      iterator& operator++() {
+        ++it_;
+        skip_dead();
+        return *this;
+      }
+
+      bool operator!=(const iterator& it) const { return it_ != it.it_; }
+
+      bool operator==(const iterator& it) const { return it_ == it.it_; }
+    };
+
+    AliveEdgeRange(EdgeRange edges, const GraphView* view, size_t size)
+        : edges_(edges), view_(view), size_(size) {}
+
+    iterator begin() const {
+      return iterator(edges_.begin(), edges_.end(), view_);
+    }
+
+    iterator end() const {
+      return iterator(edges_.end(), edges_.end(), view_);
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+  };
+
+  GraphView(const Graph& graph) : graph_(graph) {
+    unode_int n_ids = 0;
+    for (auto node : graph.get_nodes())
+      n_ids = node + 1;
+    alive_.assign((n_ids + 63) / 64, 0);
+    out_degree_.assign(n_ids, 0);
+    in_degree_.assign(n_ids, 0);
+    for (auto node : graph.get_nodes()) {
+      alive_[node / 64] |= 1ULL << (node % 64);
+      out_degree_[node] = graph.get_neighbours(node).size();
+      in_degree_[node] = graph.get_neighbours(node, true).size();
+      num_nodes_++;
+    }
+    num_edges_ = graph.get_number_edges();
+  }
+
+  const Graph& get_graph() const { return graph_; }
+
+  bool has_node(unode_int node) const {
+    return node / 64 < alive_.size() && (alive_[node / 64] >> (node % 64)) & 1;
+  }
+
+  /**
+    Removes `node` and its edges from the view.
+  */
+  void remove_node(unode_int node) {
+    if (!has_node(node))
+      return;
+    for (auto& edge : graph_.get_neighbours(node)) {
+      if (has_node(edge.target)) {
+        in_degree_[edge.target]--;
+        num_edges_--;
+      }
+    }
+    alive_[node / 64] &= ~(1ULL << (node % 64));  // Self loops counted once
+    for (auto& edge : graph_.get_neighbours(node, true)) {
+      if (has_node(edge.target)) {
+        out_degree_[edge.target]--;
+        num_edges_--;
+      }
+    }
+    out_degree_[node] = 0;
+    in_degree_[node] = 0;
+    num_nodes_--;
+  }
+
+  /**
+    Number of live edges leaving `node` (entering it if `inv`).
+  */
+  uedge_int get_degree(unode_int node, bool inv=false) const {
+    if (!has_node(node))
+      return 0;
+    return inv ? in_degree_[node] : out_degree_[node];
+  }
+
+  bool has_neighbours(unode_int node, bool inv=false) const {
+    return get_degree(node, inv) > 0;
+  }
+
+  AliveEdgeRange get_neighbours(unode_int node, bool inv=false) const {
+    if (!has_node(node))
+      return AliveEdgeRange(EdgeRange(), this, 0);
+    return AliveEdgeRange(graph_.get_neighbours(node, inv), this,
+                          get_degree(node, inv));
+  }
+
+  NodeRange get_nodes() const {
+    return NodeRange(alive_.data(), alive_.size());
+  }
+
+  unode_int get_number_nodes() const { return num_nodes_; }
+
+  uedge_int get_number_edges() const { return num_edges_; }
+};
+
+#endif /* defined(__oim__GraphView__) */
@@ -0,0 +1,253 @@
+/*
+ Copyright (c) 2015-2017 Paul Lagrée, Siyu Lei, Silviu Maniu, Luyi Mo
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#ifndef __oim__LargeAllocator__
+#define __oim__LargeAllocator__
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)  // Transparent huge pages of x86-64
+#define MPOL_INTERLEAVE_MODE 3  // MPOL_INTERLEAVE of <numaif.h>
+
+/**
+  Allocation policy of the large arrays (CSR of graphs, edge parameters, lists
+  of RR sets), through `LargeAllocator`. Arrays of at least `HUGE_PAGE_SIZE`
+  bytes are then mapped apart, aligned on huge pages, and
+  - backed by transparent huge pages (`madvise(MADV_HUGEPAGE)`), which divides
+    the TLB misses of random accesses, if `huge_pages` is set;
+  - interleaved over the NUMA nodes of the machine (`mbind`), so that threads
+    of all sockets get the same bandwidth, if `interleave` is set.
+  Smaller arrays, or all arrays if neither is set, use the usual allocator.
+  The kernel may refuse either request, hence `report`, which tells what was
+  actually granted.
+*/
+class LargeMemory {
+ private:
+  bool huge_pages_ = false;
+  bool interleave_ = false;
+  std::vector<unsigned long> numa_mask_;  // Online NUMA nodes
+  unsigned int n_numa_nodes_ = 0;
+  std::mutex mutex_;
+  std::unordered_map<void*, size_t> mappings_;  // Address -> mapped bytes
+  std::atomic<size_t> mapped_bytes_{0};
+  std::atomic<size_t> advised_bytes_{0};
+  std::atomic<size_t> interleaved_bytes_{0};
+  std::atomic<size_t> n_mappings_{0};
+
+  LargeMemory() { read_numa_nodes(); }
+
+ public:
+  static LargeMemory& get_instance() {
+    static LargeMemory instance;
+    return instance;
+  }
+
+  void set_huge_pages(bool huge_pages) { huge_pages_ = huge_pages; }
+
+  void set_interleave(bool interleave) { interleave_ = interleave; }
+
+  bool is_enabled() const { return huge_pages_ || interleave_; }
+
+  unsigned int get_numa_nodes() const { return n_numa_nodes_; }
+
+  /**
+    Bytes of large arrays mapped since the start, and number of mappings.
+  */
+  size_t get_mapped_bytes() const { return mapped_bytes_; }
+
+  size_t get_number_mappings() const { return n_mappings_; }
+
+  /**
+    Whether `ptr` is a large array currently mapped apart.
+  */
+  bool is_mapped(void* ptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mappings_.count(ptr) > 0;
+  }
+
+  void* allocate(size_t bytes) {
+    if (!is_enabled() || bytes < HUGE_PAGE_SIZE)
+      return ::operator new(bytes);
+    size_t length = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    // Over-maps by one huge page to align the start, then trims
+    void* addr = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED)
+      throw std::bad_alloc();
+    uintptr_t start = (uintptr_t)addr;
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (aligned > start)
+      munmap(addr, aligned - start);
+    munmap((void*)(aligned + length), start + HUGE_PAGE_SIZE - aligned);
+    void* region = (void*)aligned;
+    if (huge_pages_ && madvise(region, length, MADV_HUGEPAGE) == 0)
+      advised_bytes_ += length;
+    if (interleave_ && n_numa_nodes_ > 1 &&
+        syscall(SYS_mbind, region, length, MPOL_INTERLEAVE_MODE,
+                numa_mask_.data(), numa_mask_.size() * 64 + 1, 0) == 0)
+      interleaved_bytes_ += length;
+    mapped_bytes_ += length;
+    n_mappings_++;
+    std::lock_guard<std::mutex> lock(mutex_);
+    mappings_[region] = length;
+    return region;
+  }
+
+  /**
+    Frees `ptr` of `bytes` bytes (as given to `allocate`).
+  */
+  void deallocate(void* ptr, size_t bytes) {
+    if (ptr == nullptr)
+      return;
+    if (bytes >= HUGE_PAGE_SIZE) {  // Mapped if the policy was enabled
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = mappings_.find(ptr);
+      if (it != mappings_.end()) {
+        size_t length = it->second;
+        mappings_.erase(it);
+        munmap(ptr, length);
+        return;
+      }
+    }
+    ::operator delete(ptr);
+  }
+
+  /**
+    Writes what was requested and granted: bytes of large arrays mapped since
+    the start, bytes accepted by `madvise` and `mbind`, and the huge pages
+    currently backing the memory of the process (AnonHugePages).
+  */
+  void report(std::ostream& out) const {
+    const size_t mb = 1024 * 1024;
+    out << "Large arrays: " << mapped_bytes_ / mb << " MB in " << n_mappings_
+        << " mappings";
+    if (huge_pages_)
+      out << ", huge pages advised for " << advised_bytes_ / mb
+          << " MB (THP " << read_thp_mode() << "), "
+          << anon_huge_pages() / mb << " MB granted";
+    if (interleave_) {
+      if (n_numa_nodes_ > 1)
+        out << ", interleaved over " << n_numa_nodes_ << " NUMA nodes for "
+            << interleaved_bytes_ / mb << " MB";
+      else
+        out << ", not interleaved (single NUMA node)";
+    }
+    out << std::endl;
+  }
+
+ private:
+  /**
+    Reads the online NUMA nodes (e.g. "0-1,3") as a bit mask for `mbind`.
+  */
+  void read_numa_nodes() {
+    std::ifstream file("/sys/devices/system/node/online");
+    std::string ranges;
+    if (!(file >> ranges))
+      return;
+    size_t pos = 0;
+    while (pos < ranges.size()) {
+      size_t end = ranges.find(',', pos);
+      if (end == std::string::npos)
+        end = ranges.size();
+      std::string range = ranges.substr(pos, end - pos);
+      size_t dash = range.find('-');
+      unsigned int first = std::stoul(range.substr(0, dash));
+      unsigned int last = (dash == std::string::npos)
+          ? first : std::stoul(range.substr(dash + 1));
+      for (unsigned int node = first; node <= last; node++) {
+        if (node / 64 >= numa_mask_.size())
+          numa_mask_.resize(node / 64 + 1, 0);
+        numa_mask_[node / 64] |= 1UL << (node % 64);
+        n_numa_nodes_++;
+      }
+      pos = end + 1;
+    }
+  }
+
+  static std::string read_thp_mode() {
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string mode;
+    while (file >> mode)
+      if (mode.front() == '[')
+        return mode.substr(1, mode.size() - 2);
+    return "unavailable";
+  }
+
+  /**
+    Bytes of the process currently backed by transparent huge pages.
+  */
+  static size_t anon_huge_pages() {
+    std::ifstream file("/proc/self/smaps_rollup");
+    std::string key;
+    size_t kb;
+    while (file >> key) {
+      if (key == "AnonHugePages:" && file >> kb)
+        return kb * 1024;
+      file.ignore(256, '\n');
+    }
+    return 0;
+  }
+};
+
+/**
+  Allocator of the large arrays, following the policy of `LargeMemory`.
+*/
+template<typename T>
+class LargeAllocator {
+ public:
+  typedef T value_type;
+
+  LargeAllocator() = default;
+
+  template<typename U>
+  LargeAllocator(const LargeAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    return (T*)LargeMemory::get_instance().allocate(n * sizeof(T));
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    LargeMemory::get_instance().deallocate(ptr, n * sizeof(T));
+  }
+
+  template<typename U>
+  bool operator==(const LargeAllocator<U>&) const { return true; }
+
+  template<typename U>
+  bool operator!=(const LargeAllocator<U>&) const { return false; }
+};
+
+template<typename T>
+using LargeVector = std::vector<T, LargeAllocator<T>>;
+
+#endif /* defined(__oim__LargeAllocator__) */
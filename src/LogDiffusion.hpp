@@ -30,6 +30,7 @@
 #include <math.h>
 
 #include "common.hpp"
+#include "Graph.hpp"
 
 
 /**
@@ -37,7 +38,7 @@
 */
 class LogDiffusion {
  private:
-  boost::mt19937 gen_;
+  std::mt19937 gen_;
   // Logs of cascades
   std::unordered_map<unode_int, std::vector<std::vector<unode_int>>> cascades_;
 
@@ -66,8 +67,10 @@ class LogDiffusion {
   /**
     Load cascades from logs. The input file must be of the form:
       <seed> <TAB> <u1> <TAB> <u2> <TAB> ... <TAB> <un>
+    Ids of the logs are those of the input graph, they are converted into the
+    internal ids of `graph` (see `Graph::reorder_nodes`).
   */
-  void load_cascades(std::string filename) {
+  void load_cascades(std::string filename, const Graph& graph) {
     std::ifstream file(filename);
     std::string line;
     while (std::getline(file, line)) {
@@ -78,9 +81,9 @@ class LogDiffusion {
       do {
         unode_int activated;
         iss >> activated;
-        cascade.push_back(activated);
+        cascade.push_back(graph.internal_id(activated));
       } while (iss);
-      cascades_[source].push_back(cascade);
+      cascades_[graph.internal_id(source)].push_back(cascade);
     }
   }
 };
@@ -39,6 +39,7 @@
 #include "InfluenceDistribution.hpp"
 #include "SingleInfluence.hpp"
 #include "Graph.hpp"
+#include "GraphView.hpp"
 
 
 typedef std::unordered_map<unode_int, unode_int> cc_map;
@@ -55,6 +56,7 @@ class OhsakaEvaluator : public Evaluator {
   std::vector<cc_map> cc;
   std::vector<cc_node_map> cc_list;
   std::vector<Graph> graphs;
+  std::vector<GraphView> views;  // Nodes removed from the DAGs by update_dag
   std::vector<std::unordered_set<unode_int>> A;
   std::vector<std::unordered_set<unode_int>> D;
   std::vector<unode_int> h;
@@ -71,19 +73,19 @@ class OhsakaEvaluator : public Evaluator {
   unode_int cur_index;
 
   // random devices
-  std::random_device rd;
   std::mt19937 gen;
   std::uniform_real_distribution<> dist;
 
 public:
-  OhsakaEvaluator(unsigned int R) : R_(R), gen(rd()), dist(0, 1) {};
+  OhsakaEvaluator(unsigned int R) : R_(R), gen(seed_ns()), dist(0, 1) {};
 
   std::unordered_set<unode_int> select(
       const Graph& graph, Sampler& sampler,
       const std::unordered_set<unode_int>& activated, unsigned int k) {
 
     A.clear(); D.clear(); h.clear(); latest.clear(); delta.clear();
-    graphs.clear(); cc.clear(); cc_list.clear();
+    views.clear(); graphs.clear(); cc.clear(); cc_list.clear();
+    graphs.reserve(R_);  // Views keep references to the DAGs
     std::unordered_set<unode_int> set;
 
     // Sample the graphs and create DAGs and supporting structures
@@ -95,10 +97,10 @@ public:
       std::unordered_set<unode_int> cur_D;
       A.push_back(cur_A); D.push_back(cur_D);
       //find the highest degree node (only outgoing)
-      for (auto node : graphs[i].get_nodes()) {
+      for (auto node : views[i].get_nodes()) {
         unode_int deg = 0;
-        if (graphs[i].has_neighbours(node))
-          deg = graphs[i].get_neighbours(node).size();
+        if (views[i].has_neighbours(node))
+          deg = views[i].get_degree(node);
         if (deg >= max_val) {
           max_val = deg;
           max_node = node;
@@ -114,12 +116,12 @@ public:
       // Compute the set of ancestors and descendants
       h.push_back(max_node);
       bfs(h[i], i,D[i]);
-      for (auto node : graphs[i].get_nodes())
+      for (auto node : views[i].get_nodes())
         if (node != h[i] && (D[i].find(node) == D[i].end()))
           bfs(node, i, A[i], true, h[i]);
       std::unordered_map<unode_int, bool> cur_latest;
       std::unordered_map<unode_int, float> cur_delta;
-      for (auto node : graphs[i].get_nodes()) {
+      for (auto node : views[i].get_nodes()) {
         cur_latest[node] = false;
         cur_delta[node] = 0.0;
       }
@@ -168,12 +170,12 @@ public:
     for (auto val : pred) {
       dag.add_node(val.first);
       if (cur_cc[val.second] != cur_cc[val.first]) {
-        std::unique_ptr<InfluenceDistribution>
-            dst_one(new SingleInfluence(1.0));
-        dag.add_edge(cur_cc[val.second], cur_cc[val.first], std::move(dst_one));
+        dag.add_edge(cur_cc[val.second], cur_cc[val.first], 1.0);
       }
     }
-    graphs.push_back(dag);
+    dag.freeze();
+    graphs.push_back(std::move(dag));
+    views.emplace_back(graphs.back());
     while (vis_stack.size() != 0) vis_stack.pop();
   }
 
@@ -186,8 +188,8 @@ public:
     vis_stack.push(node);
     // Recursive loop for finding cycles
     if (graph.has_neighbours(node)) {
-      for (auto edge : graph.get_neighbours(node)) {
-        double dice_dst = edge.dist->sample(sampler.get_type());
+      for (auto& edge : graph.get_neighbours(node)) {
+        double dice_dst = graph.get_influence(edge, sampler.get_type());
         double dice = dist(gen);
         if (dice < dice_dst) {
           if (index.find(edge.target) == index.end()) {
@@ -224,8 +226,8 @@ public:
       unode_int cur_node = q.front();
       q.pop();
       visited.insert(cur_node);
-      if (graphs[i].has_neighbours(cur_node)) {
-        for (auto neigh : graphs[i].get_neighbours(cur_node)) {
+      if (views[i].has_neighbours(cur_node)) {
+        for (auto neigh : views[i].get_neighbours(cur_node)) {
           if(visited.find(neigh.target) == visited.end()) {
             q.push(neigh.target);
             visited.insert(neigh.target);
@@ -244,7 +246,7 @@ public:
   float gain(int i, unode_int node,
              std::unordered_set<unode_int>& set) {
     unode_int v = cc[i][node];
-    if (!graphs[i].has_node(v)) return 0.0;
+    if (!views[i].has_node(v)) return 0.0;
     if (latest[i][v]) return delta[i][v];
     latest[i][v] = true;
     // If part of the ancestors of h[i], prune
@@ -265,10 +267,10 @@ public:
          (set.size()==0))
         continue;
       delta[i][v] = delta[i][v] + (float)(cc_list[i][u].size());
-      if(graphs[i].has_neighbours(u))
-        for(auto neigh:graphs[i].get_neighbours(u)){
+      if(views[i].has_neighbours(u))
+        for(auto neigh:views[i].get_neighbours(u)){
           if((X.find(neigh.target)==X.end())&&\
-             graphs[i].has_node(neigh.target)){
+             views[i].has_node(neigh.target)){
             Q.push(neigh.target);
             X.insert(neigh.target);
           }
@@ -281,7 +283,7 @@ public:
     unode_int t = cc[i][node];
     std::unordered_set<unode_int> desc;
     bfs(t,i,desc);
-    for(auto v:graphs[i].get_nodes()){
+    for(auto v:views[i].get_nodes()){
       if(latest[i][v]){
         for(auto u:desc){
           std::unordered_set<unode_int> reach;
@@ -293,7 +295,7 @@ public:
         }
       }
     }
-    for(auto node:desc) graphs[i].remove_node(node);
+    for(auto node:desc) views[i].remove_node(node);
   }
 
 };
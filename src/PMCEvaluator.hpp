@@ -37,6 +37,7 @@
 #include "Graph.hpp"
 #include "Evaluator.hpp"
 #include "Sampler.hpp"
+#include "SnapshotStore.hpp"
 
 using namespace std;
 
@@ -342,7 +343,7 @@ class PMCEvaluator : public Evaluator {
   std::vector<unode_int> rs1_;
   std::vector<unode_int> at_e_;
   std::vector<unode_int> at_r_;
-  std::random_device rd_;
+  std::shared_ptr<SnapshotStore> snapshots_;  // Live-edge graphs of the DAGs
   unsigned int R_;  // Number of DAGs (Directed Acyclic Graphs)
   unsigned int type_;
   unode_int n_; // Number of vertices
@@ -398,7 +399,14 @@ class PMCEvaluator : public Evaluator {
 
  public:
   PMCEvaluator(unsigned int R)
-      : R_(R) {};
+      : PMCEvaluator(std::make_shared<SnapshotStore>(R)) {};
+
+  /**
+    PMC on the snapshots of `snapshots`, which may be shared with other
+    evaluators.
+  */
+  PMCEvaluator(std::shared_ptr<SnapshotStore> snapshots)
+      : snapshots_(snapshots), R_(snapshots->size()) {};
 
   std::unordered_set<unode_int> select(
         const Graph& graph, Sampler& sampler,
@@ -416,24 +424,20 @@ class PMCEvaluator : public Evaluator {
 
   	std::vector<PrunedEstimator> infs(R_);
 
+    // Snapshots are only drawn again if the graph changed since the last call
+    snapshots_->get(graph, type_);
   	for (unsigned int t = 0; t < R_; t++) {
-  		Xorshift xs = Xorshift(t + seed_ns());
   		unsigned int mp = 0;      // Number of living edges
   		at_e_.assign(n_ + 1, 0);  // For each node, number of outgoing living edges (cumsum, dont know why)
   		at_r_.assign(n_ + 1, 0);  // For each node, number of incoming living edges (cumsum)
   		std::vector<pair<unode_int, unode_int>> ps; // List of reversed living edges
 
-  		for (unode_int i = 0; i < n_; i++) {
-        if (!graph.has_neighbours(i))
-          continue;
-        for (auto& edge : graph.get_neighbours(i)) {
-    			if (xs.gen_double() < edge.dist->sample(type_)) {
-    				es1_[mp++] = edge.target;   // Lists of activated nodes (targets)
-    				at_e_[edge.source + 1]++;
-    				ps.push_back(make_pair(edge.target, edge.source));
-    			}
-        }
-  		}
+      snapshots_->for_each_live_edge(graph, type_, t,
+                                     [&](unode_int source, unode_int target) {
+  			es1_[mp++] = target;   // Lists of activated nodes (targets)
+  			at_e_[source + 1]++;
+  			ps.push_back(make_pair(target, source));
+      });
   		at_e_[0] = 0;
 
   		sort(ps.begin(), ps.end());
@@ -58,20 +58,22 @@ class PathSampler : public Sampler {
                 const std::unordered_set<unode_int>& activated,
                 const std::unordered_set<unode_int>& seeds,
                 unode_int samples) {
-    return perform_sample(graph, activated, seeds, samples, false);
+    return perform_sample(graph, activated, seeds, samples, nullptr);
   }
 
+  using Sampler::trial;
+
   double trial(const Graph& graph,
                const std::unordered_set<unode_int>& activated,
-               const std::unordered_set<unode_int>& seeds, bool inv) {
-    return perform_sample(graph, activated, seeds, 1, true, inv);
+               const std::unordered_set<unode_int>& seeds, TrialSink& sink,
+               bool inv) {
+    return perform_sample(graph, activated, seeds, 1, &sink, inv);
   }
 
-  std::shared_ptr<vector<unode_int>> perform_unique_sample(
-      const Graph&, vector<unode_int>&,
-      vector<bool>&, const unode_int,
-      const std::unordered_set<unode_int>&, bool) {
-    return shared_ptr<vector<unode_int>>(NULL);
+  unode_int perform_unique_sample(const Graph&, unode_int, RRSets&, bool) {
+    std::cerr << "Error: RR sets are only sampled by SpreadSampler."
+              << std::endl;
+    exit(1);
   }
 
   std::unordered_set<unode_int> perform_diffusion(
@@ -83,7 +85,7 @@ private:
   double perform_sample(const Graph& graph,
                         const std::unordered_set<unode_int>& activated,
                         const std::unordered_set<unode_int>& seeds,
-                        unode_int, bool trial, bool inv=false) {
+                        unode_int, TrialSink* sink, bool inv=false) {
     trials_.clear();
     boost::heap::fibonacci_heap<NodeType> queue;
     std::unordered_map<unode_int,
@@ -95,24 +97,14 @@ private:
       node.id = seed;
       node.prob = 1.0;
       queue_nodes[seed] = queue.push(node);
-      if (trial) {
-        TrialType tt;
-        tt.source = node.id;
-        tt.target = node.id;
-        tt.trial = 1;
-        trials_.push_back(tt);
-      }
+      if (sink != nullptr)
+        sink->add(node.id, node.id, 1);
     }
     while (queue.size() > 0) {
       NodeType node = queue.top();
       queue.pop();
-      if(trial) {
-        TrialType tt;
-        tt.source = node.id;
-        tt.target = node.id;
-        tt.trial = 1;
-        trials_.push_back(tt);
-      }
+      if (sink != nullptr)
+        sink->add(node.id, node.id, 1);
       if (activated.find(node.id) == activated.end())
         spread += node.prob;
       if (node.prob < 0.001)
@@ -132,9 +124,9 @@ private:
       bool inv=false) {
 
     if (graph.has_neighbours(node, inv)) {
-      for (auto edge : graph.get_neighbours(node, inv)) {
+      for (auto& edge : graph.get_neighbours(node, inv)) {
         if (visited.find(edge.target) == visited.end()) {
-          double dst_prob = edge.dist->sample(type_);
+          double dst_prob = graph.get_influence(edge, type_, inv);
           relax(node, edge.target, dst_prob, queue, queue_nodes);
         }
       }
@@ -0,0 +1,182 @@
+/*
+ Copyright (c) 2015 Siyu Lei, Silviu Maniu, Luyi Mo
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#ifndef __oim__RRSets__
+#define __oim__RRSets__
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "common.hpp"
+#include "LargeAllocator.hpp"
+
+#define RR_BLOCK_NODES (1UL << 21)  // Nodes of a block of RRSets (8 MB)
+
+/**
+  Append-only list of RR sets (reverse reachable sets), owned by the
+  evaluator sampling them. The nodes of the sets are stored one set after the
+  other in an arena of blocks of RR_BLOCK_NODES nodes (or of a whole set, if
+  larger), with the offset of each set, so that a set costs its nodes plus one
+  offset, and adding one allocates nothing but new blocks. Blocks are never
+  reallocated, which would copy them and double the memory of the sets for a
+  while, so that the nodes of a set stay in place until `clear`.
+*/
+class RRSets {
+ private:
+  // Large arrays follow the allocation policy of `LargeMemory`
+  std::vector<LargeVector<unode_int>> blocks_;
+  // Set i starts at node (offsets_[i] & 0xFFFFFFFF) of block
+  // (offsets_[i] >> 32), and the set being built at offsets_.back()
+  LargeVector<uint64_t> offsets_;
+  size_t n_nodes_ = 0;  // Nodes of the sets
+
+ public:
+  /**
+    Nodes of a set.
+  */
+  class Set {
+   private:
+    const unode_int* first_;
+    const unode_int* last_;
+
+   public:
+    Set(const unode_int* first, const unode_int* last)
+        : first_(first), last_(last) {}
+
+    const unode_int* begin() const { return first_; }
+
+    const unode_int* end() const { return last_; }
+
+    size_t size() const { return last_ - first_; }
+
+    unode_int operator[](size_t i) const { return first_[i]; }
+  };
+
+  RRSets() : offsets_(1, 0) {}
+
+  /**
+    Number of sets.
+  */
+  size_t size() const { return offsets_.size() - 1; }
+
+  bool empty() const { return offsets_.size() == 1; }
+
+  /**
+    Total number of nodes of the sets.
+  */
+  size_t get_number_nodes() const { return n_nodes_; }
+
+  Set operator[](size_t i) const {
+    uint64_t first = offsets_[i], last = offsets_[i + 1];
+    const LargeVector<unode_int>& block = blocks_[first >> 32];
+    // The next set starts the next block if this one did not fit
+    size_t end = ((last >> 32) == (first >> 32)) ? (uint32_t)last
+                                                 : block.size();
+    return Set(block.data() + (uint32_t)first, block.data() + end);
+  }
+
+  /**
+    Adds `node` to the set being built, which is added by `close_set`.
+  */
+  void push_node(unode_int node) {
+    reserve_open(1);
+    blocks_.back().push_back(node);
+  }
+
+  /**
+    Adds the set of the nodes pushed since the last set.
+  */
+  void close_set() {
+    uint64_t next = blocks_.empty() ? 0
+        : ((uint64_t)(blocks_.size() - 1) << 32) | blocks_.back().size();
+    n_nodes_ += open_size();
+    offsets_.push_back(next);
+  }
+
+  /**
+    Adds the set of the nodes of [first, last).
+  */
+  template<typename It>
+  void add(It first, It last) {
+    reserve_open(std::distance(first, last));
+    if (first != last)
+      blocks_.back().insert(blocks_.back().end(), first, last);
+    close_set();
+  }
+
+  /**
+    Removes all the sets, keeping the first block for the next ones.
+  */
+  void clear() {
+    if (blocks_.size() > 1)
+      blocks_.resize(1);
+    if (!blocks_.empty())
+      blocks_[0].clear();
+    offsets_.resize(1);
+    offsets_[0] = 0;
+    n_nodes_ = 0;
+  }
+
+  void reserve(size_t n_sets) { offsets_.reserve(n_sets + 1); }
+
+  /**
+    Memory used by the arrays.
+  */
+  size_t memory() const {
+    size_t bytes = offsets_.capacity() * sizeof(uint64_t);
+    for (auto& block : blocks_)
+      bytes += block.capacity() * sizeof(unode_int);
+    return bytes;
+  }
+
+ private:
+  /**
+    Number of nodes pushed since the last set.
+  */
+  size_t open_size() const {
+    if (blocks_.empty())
+      return 0;
+    return blocks_.back().size() - (uint32_t)offsets_.back();
+  }
+
+  /**
+    Makes room for `n` more nodes in the set being built: if the last block
+    is full, the set is moved to a new block.
+  */
+  void reserve_open(size_t n) {
+    if (!blocks_.empty() &&
+        blocks_.back().size() + n <= blocks_.back().capacity())
+      return;
+    size_t open = open_size();
+    blocks_.emplace_back();
+    blocks_.back().reserve(std::max<size_t>(RR_BLOCK_NODES, 2 * (open + n)));
+    if (open > 0) {
+      LargeVector<unode_int>& block = blocks_[blocks_.size() - 2];
+      blocks_.back().assign(block.end() - open, block.end());
+      block.resize(block.size() - open);
+    }
+    offsets_.back() = (uint64_t)(blocks_.size() - 1) << 32;
+  }
+};
+
+#endif /* defined(__oim__RRSets__) */
@@ -27,6 +27,7 @@
 #include "Graph.hpp"
 #include "Evaluator.hpp"
 #include "Sampler.hpp"
+#include "RRSets.hpp"
 
 #include <math.h>
 #include <chrono>
@@ -41,8 +42,10 @@ using namespace std;
 class SSAEvaluator : public Evaluator {
  private:
   std::unordered_set<unode_int> seed_set_;  // Set of k selected nodes
-  vector<shared_ptr<vector<unode_int>>> rr_samples_;  // List of RR samples
-  vector<vector<unsigned int>> hyper_graph_;    // RR samples where appear each node
+  // Large arrays follow the allocation policy of `LargeMemory`
+  RRSets rr_samples_;  // List of RR samples
+  RRSets rr_scratch_;  // RR sample of `estimateInf`
+  vector<LargeVector<unsigned int>> hyper_graph_;  // RR samples where appear each node
   std::mt19937 gen_;
   double epsilon_;
   double delta_;
@@ -68,7 +71,7 @@ class SSAEvaluator : public Evaluator {
     dst_ = uniform_int_distribution<unode_int>(0, graph.get_number_nodes() - 1);
 
     for (unsigned int i = 0; i < graph.get_number_nodes(); i++) {
-      hyper_graph_.push_back(vector<unsigned int>());
+      hyper_graph_.push_back(LargeVector<unsigned int>());
     }
     double epsilon_1 = epsilon_ / 6, epsilon_2 = epsilon_ / 2;
     double epsilon_3 = (epsilon_ - epsilon_1 - epsilon_2 -
@@ -103,8 +106,6 @@ class SSAEvaluator : public Evaluator {
   double estimateInf(const Graph &graph, Sampler& sampler, double epsilon_2,
                      unsigned int k, unsigned int T_max,
                      const std::unordered_set<unode_int>& activated) {  // delta_2 = delta_3
-    vector<unode_int> nodes_activated(graph.get_number_nodes(), 0);
-    vector<bool> bool_activated(graph.get_number_nodes(), false);
     unode_int n = graph.get_number_nodes();
     // This is copied from the original code, not clear yet
     double f = (log(2 / delta_) + lgamma(n + 1) - lgamma(k + 1) -
@@ -119,9 +120,9 @@ class SSAEvaluator : public Evaluator {
         source = dst_(gen_);
       }
       // We sample a new RR set
-      shared_ptr<vector<unode_int>> rr_sample = sampler.perform_unique_sample(
-          graph, nodes_activated, bool_activated, source, activated, true);  // TODO can be improved because if we found a node from seed_set, we can stop diffusion
-      for (unode_int sampled_node : *rr_sample) {
+      rr_scratch_.clear();
+      sampler.perform_unique_sample(graph, source, rr_scratch_, true);  // TODO can be improved because if we found a node from seed_set, we can stop diffusion
+      for (unode_int sampled_node : rr_scratch_[0]) {
         if (seed_set_.find(sampled_node) != seed_set_.end()) {
           cov += 1;
           break;
@@ -139,8 +140,6 @@ class SSAEvaluator : public Evaluator {
   */
   void buildSamples(unode_int n_samples, const Graph& graph, Sampler& sampler,
                     const unordered_set<unode_int>& activated) {
-    vector<unode_int> nodes_activated(graph.get_number_nodes(), 0);
-    vector<bool> bool_activated(graph.get_number_nodes(), false);
     unsigned int nb_rr_samples = rr_samples_.size();
     for (unsigned int i = 0; i < n_samples; i++) {
       unode_int source = dst_(gen_);
@@ -148,10 +147,8 @@ class SSAEvaluator : public Evaluator {
              && (activated.size() < 0.9 * graph.get_number_nodes())) { // While the randomly sampled node was already activated
         source = dst_(gen_);
       }
-      shared_ptr<vector<unode_int>> rr_sample = sampler.perform_unique_sample(
-            graph, nodes_activated, bool_activated, source, activated, true);
-      rr_samples_.push_back(rr_sample);
-      for (unode_int node : *rr_sample) {
+      sampler.perform_unique_sample(graph, source, rr_samples_, true);
+      for (unode_int node : rr_samples_[nb_rr_samples]) {
         hyper_graph_[node].push_back(nb_rr_samples);
       }
       nb_rr_samples += 1;
@@ -174,7 +171,7 @@ class SSAEvaluator : public Evaluator {
       for (unsigned int rr_sample_id : hyper_graph_[max_node]) {
         if (!visited_samples[rr_sample_id]) {
           visited_samples[rr_sample_id] = true;
-          for (unode_int node : *rr_samples_[rr_sample_id]) {
+          for (unode_int node : rr_samples_[rr_sample_id]) {
             degree[node]--;
           }
         }
@@ -44,10 +44,9 @@ class SampleManager {
   const Graph& graph_;
   vector<SampleType> sample_pool_;
   int pointer_;
-  std::random_device rd_;
   std::mt19937 gen_;
 
-  SampleManager(const Graph& graph) : graph_(graph), gen_(rd_()) {
+  SampleManager(const Graph& graph) : graph_(graph), gen_(seed_ns()) {
     sample_pool_.clear();
     sample_pool_.reserve(MAX_R);
     pointer_ = -1;
@@ -150,15 +149,13 @@ class SampleManager {
     std::unordered_set<unode_int> seeds;
     unode_int nd = graph_nodes[dst(gen_)];
     seeds.insert(nd);
-    sampler.trial(graph_, activated, seeds, true);
-
     shared_ptr<vector<unode_int>>sample (new vector<unode_int>());
     sample->push_back(nd);
-    for (TrialType tt : sampler.get_trials()) {
-      if (tt.trial == 1) {
-        sample->push_back(tt.target);
-      }
-    }
+    auto reached = make_trial_sink(
+        [&sample](unode_int, unode_int target, unsigned int) {
+          sample->push_back(target);
+        }, false);
+    sampler.trial(graph_, activated, seeds, reached, true);
 
     if (!goodSampleFlag || (int)sample_pool_.size() >= MAX_R) {
       pointer_ = (pointer_ + 1) % (int)sample_pool_.size();
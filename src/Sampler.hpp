@@ -25,6 +25,11 @@
 
 #include "common.hpp"
 #include "Graph.hpp"
+#include "RRSets.hpp"
+#include "TrialSink.hpp"
+
+#define XOSHIRO_LANES 8    // Independent generators, updated together
+#define XOSHIRO_BATCH 512  // 64-bit words generated per refill
 
 
 /**
@@ -53,10 +58,23 @@ class Xorshift {
 		return w_ = w_ ^ (w_ >> 19) ^ t ^ (t >> 8);
 	}
 
+	inline uint64_t gen_uint64() {
+		return ((uint64_t)(unsigned int)gen_int() << 32) | (unsigned int)gen_int();
+	}
+
 	inline int gen_int(int n) {
 		return (int) (n * gen_double());
 	}
 
+	// Uniform random bit generator, for the distributions of <random>
+	typedef uint32_t result_type;
+
+	static constexpr result_type min() { return 0; }
+
+	static constexpr result_type max() { return UINT32_MAX; }
+
+	inline result_type operator()() { return (uint32_t)gen_int(); }
+
 	inline double gen_double() {
 		unsigned int a = ((unsigned int) gen_int()) >> 5, b =
 				((unsigned int) gen_int()) >> 6;
@@ -67,6 +85,106 @@ class Xorshift {
 	unsigned int x_, y_, z_, w_;
 };
 
+/**
+  Pseudorandom number generator drawing its values from a buffer, refilled by
+  XOSHIRO_LANES xoshiro256++ generators (Blackman and Vigna) stepped together.
+  The refill loop runs over the lanes with no dependency between them, so
+  that the compiler vectorizes it (4 lanes per AVX2 register), away from the
+  branchy graph code consuming the values. Same interface as Xorshift, so that
+  it can be given to `EdgeParameters::sample_live` and `live_mask`.
+*/
+class Xoshiro {
+ public:
+  Xoshiro(uint64_t seed) { reseed(seed); }
+
+  /**
+    Restarts the generator from `seed`, dropping the buffered values.
+  */
+  void reseed(uint64_t seed) {
+    for (int lane = 0; lane < XOSHIRO_LANES; lane++)  // Seeds by SplitMix64
+      for (int i = 0; i < 4; i++) {
+        seed += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        s_[i][lane] = z ^ (z >> 31);
+      }
+    pos_ = 2 * XOSHIRO_BATCH;
+  }
+
+  /**
+    Next 32 random bits (as Xorshift, in an int).
+  */
+  inline int gen_int() {
+    if (pos_ == 2 * XOSHIRO_BATCH)
+      refill();
+    return (int)buffer_[pos_++];
+  }
+
+  inline uint64_t gen_uint64() {
+    return ((uint64_t)(uint32_t)gen_int() << 32) | (uint32_t)gen_int();
+  }
+
+  inline int gen_int(int n) {
+    return (int) (n * gen_double());
+  }
+
+  inline double gen_double() {
+    return (gen_uint64() >> 11) * (1.0 / (1ULL << 53));
+  }
+
+  // Uniform random bit generator, for the distributions of <random>
+  typedef uint32_t result_type;
+
+  static constexpr result_type min() { return 0; }
+
+  static constexpr result_type max() { return UINT32_MAX; }
+
+  inline result_type operator()() { return (uint32_t)gen_int(); }
+
+  /**
+    Next `n` values of 32 random bits at once (n <= XOSHIRO_BATCH), so that
+    the caller can compare them to thresholds in a vectorized loop.
+  */
+  inline const uint32_t* gen_block(unsigned int n) {
+    if (pos_ + n > 2 * XOSHIRO_BATCH)
+      refill();
+    const uint32_t* block = buffer_ + pos_;
+    pos_ += n;
+    return block;
+  }
+
+ private:
+  alignas(64) uint64_t s_[4][XOSHIRO_LANES];
+  // Low halves of the generated words, then their high halves
+  alignas(64) uint32_t buffer_[2 * XOSHIRO_BATCH];
+  unsigned int pos_ = 2 * XOSHIRO_BATCH;  // Next value of `buffer_`
+
+  void refill() {
+    for (int k = 0; k < XOSHIRO_BATCH; k += XOSHIRO_LANES) {
+      for (int lane = 0; lane < XOSHIRO_LANES; lane++) {
+        uint64_t s0 = s_[0][lane], s1 = s_[1][lane];
+        uint64_t s2 = s_[2][lane], s3 = s_[3][lane];
+        uint64_t sum = s0 + s3;
+        uint64_t word = ((sum << 23) | (sum >> 41)) + s0;
+        buffer_[k + lane] = (uint32_t)word;
+        buffer_[XOSHIRO_BATCH + k + lane] = (uint32_t)(word >> 32);
+        uint64_t t = s1 << 17;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s_[0][lane] = s0;
+        s_[1][lane] = s1;
+        s_[2][lane] = s2;
+        s_[3][lane] = (s3 << 45) | (s3 >> 19);
+      }
+    }
+    pos_ = 0;
+  }
+};
+
 /**
   Abstract class giving methods that a sampler needs to provide to Evaluators.
   Two implementations are given so far, PathSampler -- which actually does not
@@ -79,6 +197,7 @@ class Sampler {
   unsigned int type_;
   std::vector<TrialType> trials_;
   int model_;  // 0 for linear threshold, 1 for cascade model
+  unode_int used_samples_ = 0;  // By the last call to `sample_adaptive`
 
  public:
   Sampler(unsigned int type, int model) : type_(type), model_(model) {}
@@ -91,15 +210,52 @@ class Sampler {
                         const std::unordered_set<unode_int>& seeds,
                         unode_int samples) = 0;
 
+  /**
+    Estimates the spread of `seeds` with at most `max_samples` samples,
+    stopping as soon as its relative error is at most `rel_error` with
+    probability `confidence`. The samples used are then given by
+    `get_used_samples`. By default, all `max_samples` are used.
+  */
+  virtual double sample_adaptive(const Graph& graph,
+                                 const std::unordered_set<unode_int>& activated,
+                                 const std::unordered_set<unode_int>& seeds,
+                                 unode_int max_samples, double,
+                                 double) {
+    used_samples_ = max_samples;
+    return sample(graph, activated, seeds, max_samples);
+  }
+
+  unode_int get_used_samples() const { return used_samples_; }
+
+  /**
+    Performs the *real* sample, that is, diffuses the influence from `seeds`
+    once, and gives the trials of the edges tested to `sink` as they are
+    drawn.
+  */
   virtual double trial(const Graph& graph,
                        const std::unordered_set<unode_int>& activated,
                        const std::unordered_set<unode_int>& seeds,
-                       bool inv=false) = 0;
+                       TrialSink& sink, bool inv=false) = 0;
 
-  virtual std::shared_ptr<std::vector<unode_int>> perform_unique_sample(
-      const Graph& graph, std::vector<unode_int>& nodes_activated,
-      std::vector<bool>& bool_activated, const unode_int source,
-      const std::unordered_set<unode_int>& activated, bool inv=false) = 0;
+  /**
+    Performs the real sample, saving the trials in `trials_` (see
+    `get_trials`).
+  */
+  double trial(const Graph& graph,
+               const std::unordered_set<unode_int>& activated,
+               const std::unordered_set<unode_int>& seeds, bool inv=false) {
+    trials_.clear();
+    TrialLog log(trials_);
+    return trial(graph, activated, seeds, log, inv);
+  }
+
+  /**
+    Appends to `rr_sets` the set of the nodes reached from `source` (its RR
+    set if `inv`) in a sampled world, and returns its size.
+  */
+  virtual unode_int perform_unique_sample(const Graph& graph,
+                                          unode_int source, RRSets& rr_sets,
+                                          bool inv=false) = 0;
 
   virtual std::unordered_set<unode_int> perform_diffusion(
       const Graph& graph, const std::unordered_set<unode_int>& seeds) = 0;
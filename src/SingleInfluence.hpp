@@ -39,6 +39,8 @@ class SingleInfluence : public InfluenceDistribution {
   double mean() { return value_; }
 
   double sample(unsigned int) { return value_; }
+
+  double get_value() const { return value_; }
 };
 
 #endif /* defined(__oim__SingleInfluence__) */
@@ -0,0 +1,362 @@
+/*
+ Copyright (c) 2015 Siyu Lei, Silviu Maniu, Luyi Mo
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#ifndef __oim__SnapshotStore__
+#define __oim__SnapshotStore__
+
+#include <map>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+
+#include "common.hpp"
+#include "Graph.hpp"
+#include "Sampler.hpp"
+#include "SpreadSampler.hpp"
+#include "LargeAllocator.hpp"
+
+#define SNAPSHOT_MIN_INFLUENCE 0.001  // See `SnapshotStore::get`
+
+/**
+  Live-edge snapshots of a graph (possible worlds of the independent cascade
+  model, in which the coin of each edge was flipped once), shared by the
+  evaluators so that they are drawn once rather than at each selection: PMC
+  builds its DAGs from them, and CELF evaluates its spreads on them (as
+  StaticGreedy does). The snapshots are kept as bitmaps, by groups of 64: a
+  word per edge tells in which snapshots of the group it is live, so that
+  spreads are propagated in the 64 snapshots at once (as in
+  `SpreadSampler::sample_worlds`), or in each snapshot in turn when the
+  first group shows that they share too few nodes (see
+  `SpreadSampler::use_parallel_sample`).
+
+  Snapshots are kept by influence type, and drawn again only when the graph
+  changes: when its edges change, or when the influence of an edge moves by
+  more than a fraction `tolerance_` of the one they were drawn with (e.g.
+  after the updates of the model graph). The change is relative, as small
+  influences (p = 0.01, 1 / indeg...) can be multiplied without moving by
+  much; influences below SNAPSHOT_MIN_INFLUENCE count as that. Influences
+  drawn from the posteriors (INFLUENCE_THOMPSON) differ at each draw, so that
+  their snapshots are drawn at each call.
+*/
+class SnapshotStore {
+ private:
+  /**
+    Snapshots of one influence type, with the state of the graph they were
+    drawn from. Edges are indexed in the order of the graph (by source, then
+    as listed by `Graph::get_neighbours`).
+  */
+  struct Entry {
+    std::vector<LargeVector<uint64_t>> live;  // By group: live mask by edge
+    std::vector<uedge_int> first_edges;  // First edge of each node (by id)
+    std::vector<float> influences;       // Of the edges
+    uint64_t topology = 0;               // Hash of the edges
+  };
+  unsigned int n_snapshots_;
+  double tolerance_;
+  unsigned int n_threads_;
+  std::map<unsigned int, Entry> entries_;  // By influence type
+  unsigned int n_draws_ = 0;  // Number of times snapshots were drawn
+  std::vector<float> influences_;  // Scratch space of `get`
+  std::vector<uedge_int> first_edges_;
+  std::vector<uint64_t> masks_;    // Snapshots where a node is reached
+  std::vector<uint64_t> pending_;  // Snapshots left to propagate from a node
+  std::vector<uint32_t> activated_;  // Stamped with `activated_epoch_`
+  uint32_t activated_epoch_ = 0;
+  std::vector<unode_int> work_;    // Nodes to propagate from
+  std::vector<uint32_t> visited_;  // Stamped with `epoch_`
+  uint32_t epoch_ = 0;
+
+ public:
+  SnapshotStore(unsigned int n_snapshots, double tolerance=0.05,
+                unsigned int n_threads=hardware_threads())
+      : n_snapshots_(n_snapshots), tolerance_(tolerance),
+        n_threads_(std::max(1U, std::min(n_threads, n_groups()))) {}
+
+  unsigned int size() const { return n_snapshots_; }
+
+  unsigned int get_draws() const { return n_draws_; }
+
+  /**
+    Makes the snapshots of `graph` for the given influence type current,
+    drawing them again if the graph changed since the last call for this type
+    (see the class). Other methods use the snapshots of the last call.
+  */
+  void get(const Graph& graph, unsigned int type) {
+    Entry& entry = entries_[type];
+    bool deterministic = graph.get_edge_parameters().is_deterministic(type);
+    uint64_t topology = read_edges(graph, type, deterministic);
+    bool stale = !deterministic || entry.live.empty()
+        || topology != entry.topology
+        || first_edges_ != entry.first_edges;
+    for (size_t e = 0; !stale && e < influences_.size(); e++)
+      stale = std::abs(influences_[e] - entry.influences[e]) > tolerance_ *
+          std::max(entry.influences[e], (float)SNAPSHOT_MIN_INFLUENCE);
+    if (stale) {
+      entry.influences.swap(influences_);
+      entry.first_edges.swap(first_edges_);
+      entry.topology = topology;
+      draw(graph, type, entry);
+    }
+  }
+
+  /**
+    Calls `f(source, target)` on the live edges of snapshot `t` of `graph`,
+    by increasing source.
+  */
+  template<typename F>
+  void for_each_live_edge(const Graph& graph, unsigned int type,
+                          unsigned int t, F f) const {
+    const Entry& entry = entries_.at(type);
+    const LargeVector<uint64_t>& live = entry.live[t / 64];
+    uint64_t bit = 1ULL << (t % 64);
+    for (unode_int node : graph.get_nodes())
+      for_each_edge(graph, entry, live, node, [&](unode_int target,
+                                                  uint64_t mask) {
+        if (mask & bit)
+          f(node, target);
+      });
+  }
+
+  /**
+    Average number of nodes reached from `seeds` in the snapshots of `graph`,
+    without the nodes of `activated`.
+  */
+  double spread(const Graph& graph, unsigned int type,
+                const std::unordered_set<unode_int>& activated,
+                const std::unordered_set<unode_int>& seeds) {
+    const Entry& entry = entries_.at(type);
+    unode_int n_ids = entry.first_edges.size();
+    for (unode_int node : seeds)
+      n_ids = std::max(n_ids, node + 1);
+    for (unode_int node : activated)
+      n_ids = std::max(n_ids, node + 1);
+    if (masks_.size() < n_ids) {
+      masks_.resize(n_ids, 0);
+      pending_.resize(n_ids, 0);
+      activated_.resize(n_ids, 0);
+      visited_.resize(n_ids, 0);
+    }
+    if (++activated_epoch_ == 0) {  // Stamps wrapped around
+      std::fill(activated_.begin(), activated_.end(), 0);
+      activated_epoch_ = 1;
+    }
+    for (unode_int node : activated)
+      activated_[node] = activated_epoch_;
+    // Snapshots per processed node in the first group
+    double total = reach(graph, entry, 0, seeds);
+    bool bit_parallel = total >= MIN_WORLD_SHARING * work_.size();
+    for (unsigned int g = 1; g < n_groups(); g++) {
+      if (bit_parallel) {
+        total += reach(graph, entry, g, seeds);
+      } else {
+        for (unsigned int t = 64 * g; t < std::min(64 * (g + 1), n_snapshots_);
+             t++)
+          total += reach_one(graph, entry, t, seeds);
+      }
+    }
+    return total / n_snapshots_;
+  }
+
+ private:
+  unsigned int n_groups() const { return (n_snapshots_ + 63) / 64; }
+
+  /**
+    Snapshots of group `g` (bit i for snapshot 64 * g + i).
+  */
+  uint64_t group_mask(unsigned int g) const {
+    unsigned int n = std::min(64U, n_snapshots_ - 64 * g);
+    return (n == 64) ? ~0ULL : (1ULL << n) - 1;
+  }
+
+  /**
+    Calls `f(target, mask)` on the edges leaving `node`, `mask` being the
+    live mask of the edge in `live`. Plain lists are read without iterators,
+    which the inner loops of the spreads cannot afford.
+  */
+  template<typename F>
+  static inline void for_each_edge(const Graph& graph, const Entry& entry,
+                                   const LargeVector<uint64_t>& live,
+                                   unode_int node, F f) {
+    if ((size_t)node + 1 >= entry.first_edges.size())
+      return;
+    const uint64_t* masks = live.data() + entry.first_edges[node];
+    EdgeRange edges = graph.get_neighbours(node);
+    const EdgeType* plain = edges.data();
+    if (plain != nullptr) {
+      size_t degree = edges.size();
+      for (size_t i = 0; i < degree; i++)
+        f(plain[i].target, masks[i]);
+      return;
+    }
+    for (auto& edge : edges)
+      f(edge.target, *masks++);
+  }
+
+  /**
+    Total number of nodes reached from `seeds` in the snapshots of group `g`,
+    without the activated ones.
+  */
+  double reach(const Graph& graph, const Entry& entry, unsigned int g,
+               const std::unordered_set<unode_int>& seeds) {
+    const LargeVector<uint64_t>& live = entry.live[g];
+    uint64_t all = group_mask(g);
+    work_.clear();
+    for (unode_int source : seeds) {
+      masks_[source] = all;
+      pending_[source] = all;
+      work_.push_back(source);
+    }
+    for (size_t pos = 0; pos < work_.size(); pos++) {
+      unode_int node = work_[pos];
+      uint64_t worlds = pending_[node];
+      pending_[node] = 0;
+      for_each_edge(graph, entry, live, node, [&](unode_int target,
+                                                  uint64_t mask) {
+        uint64_t reached = worlds & mask & ~masks_[target];
+        if (reached == 0)
+          return;
+        if (pending_[target] == 0)
+          work_.push_back(target);
+        pending_[target] |= reached;
+        masks_[target] |= reached;
+      });
+    }
+    double reached = 0;
+    for (unode_int node : work_) {  // Nodes listed again have a cleared mask
+      if (activated_[node] != activated_epoch_)
+        reached += __builtin_popcountll(masks_[node]);
+      masks_[node] = 0;
+    }
+    return reached;
+  }
+
+  /**
+    Number of nodes reached from `seeds` in snapshot `t`, without the
+    activated ones.
+  */
+  unode_int reach_one(const Graph& graph, const Entry& entry, unsigned int t,
+                      const std::unordered_set<unode_int>& seeds) {
+    const LargeVector<uint64_t>& live = entry.live[t / 64];
+    uint64_t bit = 1ULL << (t % 64);
+    if (++epoch_ == 0) {  // Stamps wrapped around
+      std::fill(visited_.begin(), visited_.end(), 0);
+      epoch_ = 1;
+    }
+    work_.clear();
+    for (unode_int source : seeds) {
+      visited_[source] = epoch_;
+      work_.push_back(source);
+    }
+    unode_int reached = 0;
+    for (size_t pos = 0; pos < work_.size(); pos++) {
+      unode_int node = work_[pos];
+      if (activated_[node] != activated_epoch_)
+        reached++;
+      for_each_edge(graph, entry, live, node, [&](unode_int target,
+                                                  uint64_t mask) {
+        if ((mask & bit) && visited_[target] != epoch_) {
+          visited_[target] = epoch_;
+          work_.push_back(target);
+        }
+      });
+    }
+    return reached;
+  }
+
+  /**
+    Reads the edges of `graph` in `first_edges_` and, if `deterministic`,
+    their influences for the given type in `influences_`. Returns a hash of
+    the edges.
+  */
+  uint64_t read_edges(const Graph& graph, unsigned int type,
+                      bool deterministic) {
+    influences_.clear();
+    first_edges_.assign(graph.get_id_bound() + 1, 0);
+    uint64_t hash = 0;
+    uedge_int e = 0;
+    for (unode_int node : graph.get_nodes()) {
+      first_edges_[node] = e;
+      if (!graph.has_neighbours(node))
+        continue;
+      for (auto& edge : graph.get_neighbours(node)) {
+        hash = (hash ^ node) * 0x100000001b3ULL;
+        hash = (hash ^ edge.target) * 0x100000001b3ULL;
+        if (deterministic)
+          influences_.push_back(graph.get_influence(edge, type));
+        e++;
+      }
+    }
+    first_edges_.back() = e;
+    return hash;
+  }
+
+  /**
+    Draws the snapshots of `entry`. Group g draws from its own stream, so that
+    the snapshots do not depend on the number of threads.
+  */
+  void draw(const Graph& graph, unsigned int type, Entry& entry) {
+    uint64_t key = ((uint64_t)(uint32_t)seed_ns() << 32) | (uint32_t)seed_ns();
+    entry.live.resize(n_groups());
+    parallel_chunks(n_groups(), n_threads_,
+                    [&](unsigned int, size_t begin, size_t end) {
+      for (size_t g = begin; g < end; g++) {
+        Xoshiro xs(Philox(STREAM_SNAPSHOTS, g, key).gen_uint64());
+        draw_group(graph, type, group_mask(g), xs, entry.live[g]);
+      }
+    });
+    n_draws_++;
+  }
+
+  /**
+    Draws the live masks of the edges for the snapshots of `worlds`. As for
+    `SpreadSampler::sample_worlds`, influences drawn from the posteriors are
+    drawn for each snapshot, from `xs` rather than the generator shared by the
+    parameters, so that groups can be drawn in parallel.
+  */
+  static void draw_group(const Graph& graph, unsigned int type,
+                         uint64_t worlds, Xoshiro& xs,
+                         LargeVector<uint64_t>& live) {
+    const EdgeParameters& params = graph.get_edge_parameters();
+    bool deterministic = params.is_deterministic(type);
+    live.clear();
+    live.reserve(graph.get_number_edges());
+    for (unode_int node : graph.get_nodes()) {
+      if (!graph.has_neighbours(node))
+        continue;
+      for (auto& edge : graph.get_neighbours(node)) {
+        if (deterministic) {
+          live.push_back(params.live_mask(edge.id, edge.target, type, worlds,
+                                          xs));
+          continue;
+        }
+        uint64_t mask = 0;
+        for (uint64_t rest = worlds; rest != 0; rest &= rest - 1)
+          if (params.sample_live(edge.id, edge.target, type, xs))
+            mask |= rest & -rest;
+        live.push_back(mask);
+      }
+    }
+  }
+};
+
+#endif /* defined(__oim__SnapshotStore__) */
@@ -23,11 +23,13 @@
 #ifndef __oim__SpreadSampler__
 #define __oim__SpreadSampler__
 
-#include <queue>
+#include <algorithm>
+#include <chrono>
 #include <unordered_set>
 #include <random>
 #include <boost/random.hpp>
 #include <boost/generator_iterator.hpp>
+#include <boost/math/distributions/normal.hpp>
 #include <sys/time.h>
 #include <math.h>
 
@@ -37,6 +39,13 @@
 
 using namespace std;
 
+#define MIN_WORLD_SHARING 2.5  // See `SpreadSampler::use_parallel_sample`
+#define PARALLEL_PROBE 32
+#define SKIP_MAX_INFLUENCE 0.1  // See `SpreadSampler::use_skips`
+#define SKIP_MIN_DEGREE 16
+#define SAMPLE_GROUP 64  // Cascades per random stream (`perform_group_sample`)
+#define MIN_THREAD_WORK 1e-4  // Seconds of cascades worth a thread (idem)
+
 
 /**
   LT or Independent Cascade Model Sampler of the graph (does *real* samples).
@@ -44,88 +53,137 @@ using namespace std;
 class SpreadSampler : public Sampler {
  private:
   boost::mt19937 gen_;
-  Xorshift dist_;
+  Xoshiro dist_;
   double stdev_;
+  // Scratch space of the cascades, reused by all the samples: a node is
+  // visited in the current cascade if its stamp in `visited_` is `epoch_`, so
+  // that a new cascade clears it by incrementing `epoch_`. The frontier is the
+  // part of `queue_` between `head_` and `tail_` (a node is queued at most once
+  // per cascade, so `queue_` never wraps around).
+  std::vector<uint32_t> visited_;
+  uint32_t epoch_ = 0;
+  std::vector<unode_int> queue_;
+  unode_int head_ = 0, tail_ = 0;
+  std::vector<uint32_t> activated_;  // Stamped with `activated_epoch_`
+  uint32_t activated_epoch_ = 0;
+  // Bit-parallel cascades (see `sample_worlds`): worlds where each
+  // node is active, worlds where its edges are still to be drawn, and nodes
+  // having such worlds
+  std::vector<uint64_t> masks_;
+  std::vector<uint64_t> pending_;
+  std::vector<unode_int> work_;
+  double sharing_ = 64;  // Average worlds per processed node, last measured
+  unsigned int sequential_calls_ = 0;  // Since `sharing_` was measured
+  // Groups of cascades are simulated by `n_threads_` workers, which have
+  // their own scratch space
+  unsigned int n_threads_;
+  std::vector<std::unique_ptr<SpreadSampler>> workers_;
+  double group_time_ = 0;  // Seconds per group of cascades, last measured
+
+  /**
+    Sums of the spreads of a group of cascades, and of their squares.
+  */
+  struct SpreadSums {
+    double total = 0;
+    double total_sq = 0;
+    size_t n_processed = 0;  // Nodes processed by bit-parallel cascades
+  };
+
+  struct WorkerTag {};
+
+  /**
+    Worker of `perform_group_sample`: its generator is set for each group.
+  */
+  SpreadSampler(WorkerTag, unsigned int type, int model)
+      : Sampler(type, model), gen_(0), dist_(0), n_threads_(1) {}
 
  public:
-  SpreadSampler(unsigned int type, int model)
-      : Sampler(type, model), gen_(seed_ns()), dist_(Xorshift(seed_ns())) {};
+  SpreadSampler(unsigned int type, int model,
+                unsigned int n_threads = hardware_threads())
+      : Sampler(type, model), gen_(seed_ns()), dist_(seed_ns()),
+        n_threads_(n_threads > 0 ? n_threads : 1) {};
 
   /**
-    Samples `n_samples` from seeds.
+    Samples `n_samples` from seeds. IC cascades are simulated by groups of
+    SAMPLE_GROUP on several threads (see `perform_group_sample`), 64 at a
+    time when it pays off (see `use_parallel_sample`).
   */
   double sample(const Graph& graph,
                 const std::unordered_set<unode_int>& activated,
                 const std::unordered_set<unode_int>& seeds,
                 unode_int n_samples) {
-    return perform_sample(graph, activated, seeds, n_samples, false);
+    return perform_sample(graph, activated, seeds, n_samples, nullptr);
   }
 
+  /**
+    Samples from seeds until the relative error of the spread is at most
+    `rel_error` with probability `confidence`, or `max_samples` are done (see
+    `perform_group_sample`).
+  */
+  double sample_adaptive(const Graph& graph,
+                         const std::unordered_set<unode_int>& activated,
+                         const std::unordered_set<unode_int>& seeds,
+                         unode_int max_samples, double rel_error,
+                         double confidence) {
+    if (model_ != 1 || max_samples <= 1 || rel_error <= 0)
+      return Sampler::sample_adaptive(graph, activated, seeds, max_samples,
+                                      rel_error, confidence);
+    trials_.clear();
+    double z = boost::math::quantile(boost::math::normal(),
+                                     (1 + confidence) / 2);
+    return perform_group_sample(graph, activated, seeds, max_samples, false,
+                                rel_error, z);
+  }
+
+  using Sampler::trial;
+
   /**
     Performs the *real* sample, that is, diffuse the influence from selected
-    seeds. Compared to the sample method, it saves sampled edges in `trials_`.
+    seeds. Compared to the sample method, it gives sampled edges to `sink`.
   */
   double trial(const Graph& graph,
                const std::unordered_set<unode_int>& activated,
                const std::unordered_set<unode_int>& seeds,
-               bool inv=false) {
-    return perform_sample(graph, activated, seeds, 1, true, inv);
-  }
-
-  /**
-    Performs a unique sample from `source`. This method is used for sampling
-    RR sets in SSAEvaluator. It implements both LT and IC models.
-
-    @param nodes_activated Reserved vector of size the number of nodes. It is
-        used as queue while performing the sample
-    @param bool_activated When a node is activated, mark its corresponding index
-    @return Vector containing activated nodes in this sample.
-  */
-  std::shared_ptr<vector<unode_int>> perform_unique_sample(
-        const Graph& graph, std::vector<unode_int>& nodes_activated,
-        std::vector<bool>& bool_activated, unode_int source,
-        const std::unordered_set<unode_int>&, bool inv=false) {
-    unode_int cur = source;
-    unode_int num_marked = 1, cur_pos = 0;
-    bool_activated[cur] = true;
-    nodes_activated[0] = cur;
-    while (cur_pos < num_marked) {
-      cur = nodes_activated[cur_pos];
-      cur_pos++;
+               TrialSink& sink, bool inv=false) {
+    return perform_sample(graph, activated, seeds, 1, &sink, inv);
+  }
+
+  /**
+    Performs a unique sample from `source`, appended to `rr_sets`. This method
+    is used for sampling RR sets in SSAEvaluator. It implements both LT and IC
+    models. The nodes are queued in the scratch space of the cascades, then
+    copied at once to `rr_sets`, so that no set is allocated on its own.
+
+    @return Number of activated nodes in this sample.
+  */
+  unode_int perform_unique_sample(const Graph& graph, unode_int source,
+                                  RRSets& rr_sets, bool inv=false) {
+    const EdgeParameters& params = graph.get_edge_parameters();
+    reserve_ids(std::max(graph.get_id_bound(), source + 1));
+    new_cascade();
+    visit(source);
+    auto activate = [this](const EdgeType& neighbour) {
+      visit(neighbour.target);
+    };
+    while (head_ < tail_) {
+      unode_int cur = queue_[head_++];
       if (model_ == 0) { // Linear threshold model
         int index = graph.sample_living_edge(cur, gen_);
         if (index == -1)  // Unconnected node or sample with weights summing to less than 1
           continue;
-        unode_int living_node = graph.get_neighbours(cur, true)[index].target;
-        if (!bool_activated[living_node]) {
-          bool_activated[living_node] = true;
-          nodes_activated[num_marked] = living_node;
-          num_marked++;
-        }
+        visit(graph.get_neighbours(cur, true)[index].target);
       } else if (model_ == 1) { // Independent Cascade model
-        if (graph.has_neighbours(cur, inv)) {
-          for (auto& neighbour : graph.get_neighbours(cur, inv)) {
-            if (dist_.gen_double() < neighbour.dist->sample(type_)) {
-              if (!bool_activated[neighbour.target]) {
-                bool_activated[neighbour.target] = true;
-                nodes_activated[num_marked] = neighbour.target;
-                num_marked++;
-              }
-            }
-          }
+        EdgeRange neighbours = graph.get_neighbours(cur, inv);
+        if (use_skips(params, cur, neighbours.size(), inv)) {
+          for_each_live_edge(neighbours, params.shared_influence(cur),
+                             activate);
+          continue;
         }
+        graph.draw_live_edges(cur, type_, dist_, activate, inv);
       }
     }
-    std::vector<unode_int> result;
-    for (unode_int i = 0; i < num_marked; i++) {
-      result.push_back(nodes_activated[i]);
-    }
-    std::shared_ptr<vector<unode_int>> rr_sample =
-        std::make_shared<vector<unode_int>>(result);
-    for (unsigned int i = 0; i < num_marked; i++) {
-      bool_activated[nodes_activated[i]] = false;
-    }
-    return rr_sample;
+    rr_sets.add(queue_.data(), queue_.data() + tail_);
+    return tail_;
   }
 
   /**
@@ -134,8 +192,10 @@ class SpreadSampler : public Sampler {
   */
   std::unordered_set<unode_int> perform_diffusion(const Graph& graph,
         const std::unordered_set<unode_int>& seeds) {
-    std::unordered_set<unode_int> visited;
-    std::queue<unode_int> queue;
+    reserve_scratch(graph, seeds);
+    new_cascade();
+    for (auto source : seeds)
+      visit(source);
     if (model_ == 0) {  // LT model
       std::unordered_map<unode_int, std::vector<unode_int>> live_edges;
       for (unode_int u = 0; u < graph.get_number_nodes(); u++) {
@@ -147,33 +207,21 @@ class SpreadSampler : public Sampler {
           live_edges[living_node] = std::vector<unode_int>();
         live_edges[living_node].push_back(u);
       }
-      for (auto source : seeds) {
-        queue.push(source);
-        visited.insert(source);
-      }
-      while (queue.size() > 0) {
-        auto node_id = queue.front();
-        visited.insert(node_id);
-        if (live_edges.find(node_id) != live_edges.end()) {
-          for (auto& neighbour : live_edges[node_id]) {
-            if (visited.find(neighbour) == visited.end())
-              queue.push(neighbour);
-          }
+      while (head_ < tail_) {
+        auto node_id = queue_[head_++];
+        auto it = live_edges.find(node_id);
+        if (it != live_edges.end()) {
+          for (auto& neighbour : it->second)
+            visit(neighbour);
         }
-        queue.pop();
       }
     } else if (model_ == 1) { // IC model
-      for (auto source : seeds) {
-        queue.push(source);
-        visited.insert(source);
-      }
-      while (queue.size() > 0) {
-        auto node_id = queue.front();
-        sample_outgoing_edges(graph, node_id, queue, visited, false, false);
-        queue.pop();
-      }
+      while (head_ < tail_)
+        reach_neighbours(graph, queue_[head_++], false);
     }
-    return visited; // Potentially a copy, depending on compiler's optimzations
+    // Queued nodes are the visited ones
+    return std::unordered_set<unode_int>(queue_.begin(),
+                                         queue_.begin() + tail_);
   }
 
  private:
@@ -183,24 +231,25 @@ class SpreadSampler : public Sampler {
   double perform_sample(const Graph& graph,
                         const std::unordered_set<unode_int>& activated,
                         const std::unordered_set<unode_int>& seeds,
-                        unode_int n_samples, bool trial, bool inv=false) {
+                        unode_int n_samples, TrialSink* sink,
+                        bool inv=false) {
     trials_.clear();
+    if (sink == nullptr && model_ == 1 && n_samples > 1)
+      return perform_group_sample(graph, activated, seeds, n_samples, inv);
+    reserve_scratch(graph, seeds);
+    stamp_activated(activated);
     double spread = 0;
     double outspread = 0;
     stdev_ = 0;
     for (unode_int sample = 1; sample <= n_samples; sample++) {
       double reached_round = 0; // Number of nodes activated
-      std::queue<unode_int> queue;
-      std::unordered_set<unode_int> visited;
-      for (unode_int source : seeds) {
-        queue.push(source);
-        visited.insert(source);
-      }
-      while (queue.size() > 0) {
-        unode_int node_id = queue.front();
-        sample_outgoing_edges(graph, node_id, queue, visited, trial, inv);
-        queue.pop();
-        if (activated.find(node_id) == activated.end())
+      new_cascade();
+      for (unode_int source : seeds)
+        visit(source);
+      while (head_ < tail_) {
+        unode_int node_id = queue_[head_++];
+        sample_outgoing_edges(graph, node_id, sink, inv);
+        if (activated_[node_id] != activated_epoch_)
           reached_round++;
       }
       double os = spread;
@@ -213,38 +262,346 @@ class SpreadSampler : public Sampler {
   }
 
   /**
-    Samples outgoing edges from `node`. New activated nodes are added to
-    `visited`. If `trial` is true, we add sampled edges in the vector `trials_`.
-    This method is implemented for both linear threshold and independent cascade
-    models.
+    Whether to simulate the next cascades bit-parallel. Worlds share the
+    processing of a node only if it is activated in several of them at once,
+    which depends on the graph and the seeds: below `MIN_WORLD_SHARING` worlds
+    per processed node, the bookkeeping of the worlds costs more than it saves,
+    and cascades are simulated one by one, trying again every
+    `PARALLEL_PROBE` calls.
+  */
+  bool use_parallel_sample() {
+    if (sharing_ >= MIN_WORLD_SHARING ||
+        ++sequential_calls_ >= PARALLEL_PROBE) {
+      sequential_calls_ = 0;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+    Performs `n_samples` IC cascades from `seeds`, split in groups of
+    SAMPLE_GROUP cascades. Group g draws from its own random stream
+    (STREAM_SAMPLES, g), and the groups are shared by `n_threads_` threads
+    (one only if drawing influences has side effects, see
+    `EdgeParameters::is_deterministic`), so that the result does not depend
+    on the number of threads. This number can then follow the time of the
+    last call: a thread is started for at least MIN_THREAD_WORK seconds of
+    cascades. If `rel_error` is positive, groups are run by rounds doubling
+    their number, until the half-width of the confidence interval of quantile
+    `z` of the mean (normal approximation) is at most `rel_error` times the
+    mean. Returns the average spread, without the nodes of `activated`, and
+    sets `stdev_` and `used_samples_`.
+  */
+  double perform_group_sample(const Graph& graph,
+                              const std::unordered_set<unode_int>& activated,
+                              const std::unordered_set<unode_int>& seeds,
+                              unode_int n_samples, bool inv,
+                              double rel_error=0, double z=0) {
+    bool deterministic =
+        graph.get_edge_parameters().is_deterministic(type_);
+    bool bit_parallel = deterministic && use_parallel_sample();
+    uint64_t key = ((uint64_t)(uint32_t)seed_ns() << 32) | (uint32_t)seed_ns();
+    unode_int n_groups = (n_samples + SAMPLE_GROUP - 1) / SAMPLE_GROUP;
+    std::vector<SpreadSums> sums(n_groups);
+    SpreadSums all;  // Summed in the order of groups
+    unode_int done = 0, used = 0;  // Groups and samples done
+    double spread = 0;
+    while (done < n_groups) {
+      unode_int end = (rel_error > 0) ? std::min(n_groups, 2 * done + 1)
+                                      : n_groups;
+      unsigned int n_threads = std::min<double>(
+          std::min<unode_int>(n_threads_, end - done),
+          std::max(1.0, group_time_ * (end - done) / MIN_THREAD_WORK));
+      if (!deterministic)
+        n_threads = 1;
+      auto start = std::chrono::steady_clock::now();
+      while (workers_.size() < n_threads)
+        workers_.emplace_back(new SpreadSampler(WorkerTag(), type_, model_));
+      parallel_chunks(end - done, n_threads,
+                      [&](unsigned int t, size_t begin, size_t stop) {
+        SpreadSampler& worker = *workers_[t];
+        worker.reserve_scratch(graph, seeds);
+        worker.stamp_activated(activated);
+        for (size_t g = done + begin; g < done + stop; g++) {
+          worker.dist_.reseed(Philox(STREAM_SAMPLES, g, key).gen_uint64());
+          unode_int n = std::min<unode_int>(SAMPLE_GROUP,
+                                            n_samples - g * SAMPLE_GROUP);
+          if (bit_parallel)
+            worker.sample_worlds(graph, seeds, n, inv, sums[g]);
+          else
+            worker.sample_cascades(graph, seeds, n, inv, sums[g]);
+        }
+      });
+      group_time_ = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count() * n_threads /
+          (end - done);
+      for (; done < end; done++) {
+        all.total += sums[done].total;
+        all.total_sq += sums[done].total_sq;
+        all.n_processed += sums[done].n_processed;
+      }
+      used = std::min(n_samples, done * SAMPLE_GROUP);
+      spread = all.total / used;
+      stdev_ = sqrt(std::max(0.0, (all.total_sq - all.total * spread) /
+                                      (double)(used - 1)));
+      if (rel_error > 0 && z * stdev_ / sqrt(used) <= rel_error * spread)
+        break;
+    }
+    if (bit_parallel)
+      sharing_ = all.total / std::max<size_t>(all.n_processed, 1);
+    used_samples_ = used;
+    return spread;
+  }
+
+  /**
+    Performs `n_samples` IC cascades from `seeds`, one by one, and adds their
+    spreads (without the nodes of `activated_`) to `sums`.
+  */
+  void sample_cascades(const Graph& graph,
+                       const std::unordered_set<unode_int>& seeds,
+                       unode_int n_samples, bool inv, SpreadSums& sums) {
+    for (unode_int sample = 0; sample < n_samples; sample++) {
+      double reached = 0;
+      new_cascade();
+      for (unode_int source : seeds)
+        visit(source);
+      while (head_ < tail_) {
+        unode_int node_id = queue_[head_++];
+        reach_neighbours(graph, node_id, inv);
+        if (activated_[node_id] != activated_epoch_)
+          reached++;
+      }
+      sums.total += reached;
+      sums.total_sq += reached * reached;
+    }
+  }
+
+  /**
+    Performs `n_worlds` (at most 64) IC cascades from `seeds` at once: the
+    pass propagates the possible worlds together, bit i of the mask of a node
+    telling whether it is active in world i. An edge from a node gaining
+    worlds is drawn only for these worlds, with one random mask (see
+    `EdgeParameters::live_mask`), so that each edge is still drawn at most
+    once per world. Adds the spreads, without the nodes of `activated_`, to
+    `sums`.
+  */
+  void sample_worlds(const Graph& graph,
+                     const std::unordered_set<unode_int>& seeds,
+                     unsigned int n_worlds, bool inv, SpreadSums& sums) {
+    const EdgeParameters& params = graph.get_edge_parameters();
+    if (masks_.size() < visited_.size()) {
+      masks_.resize(visited_.size(), 0);
+      pending_.resize(visited_.size(), 0);
+    }
+    uint64_t all = (n_worlds == 64) ? ~0ULL : (1ULL << n_worlds) - 1;
+    new_cascade();  // Queued nodes are the ones active in some world
+    work_.clear();
+    for (unode_int source : seeds) {
+      visit(source);
+      masks_[source] = all;
+      pending_[source] = all;
+      work_.push_back(source);
+    }
+    for (size_t pos = 0; pos < work_.size(); pos++) {
+      unode_int node = work_[pos];
+      uint64_t worlds = pending_[node];
+      pending_[node] = 0;
+      for (auto& edge : graph.get_neighbours(node, inv)) {
+        uint64_t reached = worlds & ~masks_[edge.target];
+        if (reached == 0)
+          continue;
+        if ((reached & (reached - 1)) == 0) {  // Single world
+          if (!params.sample_live(edge.id, edge.head(inv), type_, dist_))
+            continue;
+        } else {
+          reached = params.live_mask(edge.id, edge.head(inv), type_,
+                                     reached, dist_);
+          if (reached == 0)
+            continue;
+        }
+        visit(edge.target);
+        if (pending_[edge.target] == 0)
+          work_.push_back(edge.target);
+        pending_[edge.target] |= reached;
+        masks_[edge.target] |= reached;
+      }
+    }
+    unode_int reached_worlds[64] = {0};  // Spread of each world
+    sums.n_processed += work_.size();
+    for (unode_int i = 0; i < tail_; i++) {
+      unode_int node = queue_[i];
+      if (activated_[node] != activated_epoch_) {
+        for (uint64_t mask = masks_[node]; mask != 0; mask &= mask - 1)
+          reached_worlds[__builtin_ctzll(mask)]++;
+      }
+      masks_[node] = 0;
+    }
+    for (unsigned int w = 0; w < n_worlds; w++) {
+      sums.total += reached_worlds[w];
+      sums.total_sq += (double)reached_worlds[w] * reached_worlds[w];
+    }
+  }
+
+  /**
+    Whether to draw the live edges of `node` by geometric jumps (see
+    `for_each_live_edge`): its `degree` edges must share a small influence,
+    as a jump costs a logarithm where a draw costs a random integer.
+  */
+  bool use_skips(const EdgeParameters& params, unode_int node, size_t degree,
+                 bool inv) const {
+    return degree >= SKIP_MIN_DEGREE && params.has_shared_influence(inv) &&
+        params.shared_influence(node) < SKIP_MAX_INFLUENCE;
+  }
+
+  /**
+    Calls `live(edge)` for the live edges of `edges`, which all have the
+    influence `prob`. Instead of one draw per edge, it draws the geometric
+    jumps between live edges (floor(log(U) / log(1 - prob)) edges are
+    skipped), so that the cost is in the number of live edges rather than the
+    degree. Compressed lists and lists with a delta are walked, without draws.
+  */
+  template<typename Live>
+  void for_each_live_edge(const EdgeRange& edges, double prob, Live live) {
+    double log_q = log1p(-prob);  // log(1 - prob)
+    size_t degree = edges.size();
+    const EdgeType* plain = edges.data();
+    auto it = edges.begin();
+    size_t pos = 0;  // Position of `it`
+    for (size_t i = skip(log_q, degree); i < degree;
+         i += 1 + skip(log_q, degree - i - 1)) {
+      if (plain != nullptr) {
+        live(plain[i]);
+      } else {
+        for (; pos < i; pos++)
+          ++it;
+        live(*it);
+      }
+    }
+  }
+
+  /**
+    Number of edges skipped before the next live edge (at most `limit`).
+  */
+  inline size_t skip(double log_q, size_t limit) {
+    double gap = log(1.0 - dist_.gen_double()) / log_q;
+    return (gap < limit) ? (size_t)gap : limit;
+  }
+
+  /**
+    Sizes the scratch space for the nodes of `graph` and `seeds`.
+  */
+  void reserve_scratch(const Graph& graph,
+                       const std::unordered_set<unode_int>& seeds) {
+    unode_int n_ids = graph.get_id_bound();
+    for (unode_int source : seeds)
+      n_ids = std::max(n_ids, source + 1);
+    reserve_ids(n_ids);
+  }
+
+  /**
+    Sizes the scratch space for the nodes of ids below `n_ids`.
+  */
+  void reserve_ids(unode_int n_ids) {
+    if (visited_.size() < n_ids) {
+      visited_.resize(n_ids, 0);
+      queue_.resize(n_ids);
+      activated_.resize(n_ids, 0);
+    }
+  }
+
+  /**
+    Starts a new cascade: empties the visited nodes and the queue.
+  */
+  void new_cascade() {
+    if (++epoch_ == 0) {  // Stamps wrapped around
+      std::fill(visited_.begin(), visited_.end(), 0);
+      epoch_ = 1;
+    }
+    head_ = tail_ = 0;
+  }
+
+  /**
+    Marks `node` as visited and queues it, if not visited yet.
+  */
+  inline bool visit(unode_int node) {
+    if (visited_[node] == epoch_)
+      return false;
+    visited_[node] = epoch_;
+    queue_[tail_++] = node;
+    return true;
+  }
+
+  /**
+    Marks the nodes of `activated` (see `activated_`), which are not counted in
+    the spread.
+  */
+  void stamp_activated(const std::unordered_set<unode_int>& activated) {
+    if (++activated_epoch_ == 0) {
+      std::fill(activated_.begin(), activated_.end(), 0);
+      activated_epoch_ = 1;
+    }
+    for (unode_int node : activated)
+      if (node < activated_.size())
+        activated_[node] = activated_epoch_;
+  }
+
+  /**
+    Visits the neighbours of `node` (IC model) through its live edges.
+  */
+  inline void reach_neighbours(const Graph& graph, unode_int node, bool inv) {
+    reach_neighbours(graph, node, inv,
+                     [this](const EdgeType& edge) { visit(edge.target); });
+  }
+
+  /**
+    Calls `reach(edge)` for the live edges of `node` (IC model).
+  */
+  template<typename Live>
+  inline void reach_neighbours(const Graph& graph, unode_int node, bool inv,
+                               Live reach) {
+    const EdgeParameters& params = graph.get_edge_parameters();
+    size_t degree = graph.get_neighbours(node, inv).size();
+    if (use_skips(params, node, degree, inv))
+      for_each_live_edge(graph.get_neighbours(node, inv),
+                         params.shared_influence(node), reach);
+    else
+      graph.draw_live_edges(node, type_, dist_, reach, inv);
+  }
+
+  /**
+    Samples outgoing edges from `node`. New activated nodes are visited (see
+    `visit`). If `sink` is given, we give it the sampled edges, or only the
+    edges activating a node if it does not want failures, which are then drawn
+    at once. This method is implemented for both linear threshold and
+    independent cascade models.
   */
   void sample_outgoing_edges(const Graph& graph, unode_int node,
-                             std::queue<unode_int>& queue,
-                             std::unordered_set<unode_int>& visited,
-                             bool trial, bool inv=false) {
+                             TrialSink* sink, bool inv=false) {
     if (model_ == 0) { // Linear threshold model, this method isn't implemented for LT
       std::cerr << "Error: this part is only run by IC model." << std::endl;
       exit(1);
     } else if (model_ == 1) { // Independent Cascade model
-      if (graph.has_neighbours(node, inv)) {
-        for (auto edge : graph.get_neighbours(node, inv)) {
-          if (visited.find(edge.target) == visited.end()) {
-            double dice_dst = edge.dist->sample(type_);
-            unsigned int act = 0;
-            double dice = dist_.gen_double();
-            if (dice < dice_dst) {
-              visited.insert(edge.target);
-              queue.push(edge.target);
-              act = 1;
-            }
-            if (trial) {  // If trial, we want to save the generated RR set sample
-              TrialType tt;
-              tt.source = node;
-              tt.target = edge.target;
-              tt.trial = act;
-              trials_.push_back(tt);
-            }
+      if (sink == nullptr) {
+        reach_neighbours(graph, node, inv);
+        return;
+      }
+      if (!sink->wants_failures()) {
+        reach_neighbours(graph, node, inv, [&](const EdgeType& edge) {
+          if (visit(edge.target))
+            sink->add(node, edge.target, 1);
+        });
+        return;
+      }
+      const EdgeParameters& params = graph.get_edge_parameters();
+      for (auto& edge : graph.get_neighbours(node, inv)) {
+        if (visited_[edge.target] != epoch_) {
+          unsigned int act = 0;
+          if (params.sample_live(edge.id, edge.head(inv), type_, dist_)) {
+            visit(edge.target);
+            act = 1;
           }
+          // Trials are given to the sink, as the generated RR set sample
+          sink->add(node, edge.target, act);
         }
       }
     }
@@ -47,7 +47,8 @@ double reused_ratio = 0;
 struct TrialData {
   std::unordered_set<unode_int> seeds;
   double spread;
-  std::vector<TrialType> trials;
+  double n_trials;  // Number of edges tested
+  double n_hits;  // Number of live edges among them
 };
 
 /**
@@ -104,15 +105,20 @@ class OriginalGraphStrategy : public Strategy {
 
       // Evaluating the expected and real spread on the seeds
       double new_expected = 0;
-      for (unsigned int i = 0; i < samples_; i++) {
-        std::unordered_set<unode_int> spread;
-        if (log_diffusion_ == nullptr)  // We sample a diffusion according to a model
-          spread = sampler.perform_diffusion(original_graph_, seeds);
-        else    // We sample a cascade from the seeds at random (cascdes from the LOGS)
-          spread = log_diffusion_->perform_diffusion(seeds);
-        for (auto& elt : spread)
-          if (activated.find(elt) == activated.end())
-            new_expected++;
+      if (log_diffusion_ == nullptr && model_ == 1) {  // All cascades at once
+        new_expected = samples_ * sampler.sample(original_graph_, activated,
+                                                 seeds, samples_);
+      } else {
+        for (unsigned int i = 0; i < samples_; i++) {
+          std::unordered_set<unode_int> spread;
+          if (log_diffusion_ == nullptr)  // We sample a diffusion according to a model
+            spread = sampler.perform_diffusion(original_graph_, seeds);
+          else    // We sample a cascade from the seeds at random (cascdes from the LOGS)
+            spread = log_diffusion_->perform_diffusion(seeds);
+          for (auto& elt : spread)
+            if (activated.find(elt) == activated.end())
+              new_expected++;
+        }
       }
       expected += new_expected / samples_;
 
@@ -134,7 +140,7 @@ class OriginalGraphStrategy : public Strategy {
                 << roundtime << "\t" << timetotal << "\t" << k << "\t"
                 << model_ << "\t";
       for (auto seed : seeds)
-        std::cout << seed << ".";
+        std::cout << original_graph_.original_id(seed) << ".";
       std::cout << std::endl << std::flush;
     }
   }
@@ -249,7 +255,7 @@ class MissingMassStrategy : public Strategy {
                 << n_experts_ << "\t" << n_policy_ << "\t"
                 << n_graph_reduction_ << "\t" << model_ << "\t";
       for (auto seed : seeds)
-        std::cout << seed << ".";
+        std::cout << original_graph_.original_id(seed) << ".";
       std::cout << std::endl << std::flush;
     }
   }
@@ -361,7 +367,29 @@ class ExponentiatedGradientStrategy : public Strategy {
         cur_expected = explore_sampler.sample(model_graph_, activated, seeds, 100);
       }
       expected += cur_expected;
-      double cur_real = exploit_sampler.trial(original_graph_, activated, seeds);
+      // Trials are counted and learnt from as they are drawn, and kept for
+      // the update of the model only, failed trials being drawn only if
+      // needed
+      TrialData result;
+      result.n_trials = 0;
+      result.n_hits = 0;
+      std::vector<unode_int> reached;
+      std::vector<TrialType> trials;
+      auto sink = make_trial_sink(
+          [&](unode_int source, unode_int target, unsigned int live) {
+            if (live == 1)
+              reached.push_back(target);
+            if (update_)
+              trials.push_back({source, target, live});
+            result.n_trials++;
+            result.n_hits += live;
+            if (learn_ == 2) {
+              long long edge = source * 100000000LL + target;
+              ++((live == 0) ? edge_miss : edge_hit)[edge];
+            }
+          }, update_ || learn_ >= 2);
+      double cur_real = exploit_sampler.trial(original_graph_, activated, seeds,
+                                              sink);
       double cur_gain = 1.0 - std::abs(cur_real - cur_expected) / cur_expected;
       real += cur_real;
       // Recalibrating
@@ -380,31 +408,16 @@ class ExponentiatedGradientStrategy : public Strategy {
       t1 = get_timestamp();
       selectingtime = (double)(t1 - t0) / 1000000;
 
-      std::unordered_set<unode_int> nodes_to_update;
-      for (unode_int node : seeds) {
+      for (unode_int node : seeds)
         activated.insert(node);
-        nodes_to_update.insert(node);
-      }
-      unsigned int hits = 0, misses = 0;
-      for (TrialType tt : exploit_sampler.get_trials()) {
-        nodes_to_update.insert(tt.target);
-        if (tt.trial == 1) {
-          hits++;
-          activated.insert(tt.target);
-        } else {
-          misses++;
-        }
-        if (update_)
-          model_graph_.update_edge(tt.source, tt.target, tt.trial);
-      }
+      activated.insert(reached.begin(), reached.end());
+      if (update_)
+        model_graph_.apply_trials(trials);
 
       if (learn_ > 0) {
-        TrialData result;
         for (unode_int seed : seeds)
           result.seeds.insert(seed);
         result.spread = cur_real;
-        for (TrialType tt : exploit_sampler.get_trials())
-          result.trials.push_back(tt);
         results.push_back(result);
         // Linear regression learning
         if (learn_ == 1) {
@@ -418,12 +431,14 @@ class ExponentiatedGradientStrategy : public Strategy {
           for (TrialData res : results) {
             double x = res.spread - 1;
             double y = 0;
+            const EdgeParameters& params = model_graph_.get_edge_parameters();
             for (unode_int seed : res.seeds) {
               double o = 0, t = 0, h = 0;
-              for (auto node : model_graph_.get_neighbours(seed)) {
+              for (auto& node : model_graph_.get_neighbours(seed)) {
                 o += 1;
-                t += (double)(node.dist->get_hits() + node.dist->get_misses());
-                h += (double)node.dist->get_hits();
+                t += (double)(params.get_hits(node.id) +
+                              params.get_misses(node.id));
+                h += (double)params.get_hits(node.id);
               }
               y += -(t + 1) * x + (o + h) * avg_spread;
             }
@@ -435,24 +450,13 @@ class ExponentiatedGradientStrategy : public Strategy {
         } else if (learn_ == 3) { // MLE learning
           double t = 0.0, a = 0.0;
           for (TrialData res : results) {
-            t += (double)res.trials.size();
-            for (TrialType tt : res.trials) a += (double)tt.trial;
+            t += res.n_trials;
+            a += res.n_hits;
           }
           alpha += a;
           beta += t - a;
         } else if (learn_ == 2) { // MLE with alpha = 1
-          for (TrialType tt : result.trials) {
-            long long edge = tt.source * 100000000LL + tt.target;
-            if (tt.trial == 0) {
-              auto iter = edge_miss.find(edge);
-              if (iter == edge_miss.end()) edge_miss[edge] = 1;
-              else ++(iter->second);
-            } else {
-              auto iter = edge_hit.find(edge);
-              if (iter == edge_hit.end()) edge_hit[edge] = 1;
-              else ++(iter->second);
-            }
-          }
+          // Hits and misses of the edges are counted by the trial sink
           alpha = 1;
           double a = 0.0;
           for (auto item = edge_hit.begin(); item != edge_hit.end(); ++item) {
@@ -493,7 +497,7 @@ class ExponentiatedGradientStrategy : public Strategy {
           << totaltime  << "\t" << (int)cur_theta - THETA_OFFSET - 1 << "\t"
           << memory << "\t" << k << "\t" << model_ << "\t";
       for (auto seed : seeds)
-        std::cout << seed << ".";
+        std::cout << original_graph_.original_id(seed) << ".";
       std::cout << std::endl << std::flush;
     }
   }
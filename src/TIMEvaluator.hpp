@@ -30,6 +30,7 @@
 #include "SpreadSampler.hpp"
 #include "PathSampler.hpp"
 #include "SampleManager.hpp"
+#include "RRSets.hpp"
 
 #include <math.h>
 
@@ -45,16 +46,16 @@ class TIMEvaluator : public Evaluator {
   double epsilon_;
 
   std::unordered_set<unode_int> seed_set_;
-  std::vector<std::shared_ptr<std::vector<unode_int>>> rr_sets_;
+  // Large arrays follow the allocation policy of `LargeMemory`
+  RRSets rr_sets_;
   std::vector<unode_int> graph_nodes_;
-  std::vector<std::shared_ptr<std::vector<unode_int>>> hyper_g_;
+  LargeVector<std::shared_ptr<LargeVector<unode_int>>> hyper_g_;
   unode_int hyper_id_;
   unode_int total_r_;
-  std::random_device rd_;
   std::mt19937 gen_;
 
  public:
-  TIMEvaluator() : gen_(rd_()) {};
+  TIMEvaluator() : gen_(seed_ns()) {};
 
   std::unordered_set<unode_int> select(
       const Graph& graph, Sampler& sampler,
@@ -118,6 +119,11 @@ class TIMEvaluator : public Evaluator {
     double lb = 1 / 2.0;
     double c = 0;
     unode_int last_r = 0;
+    std::vector<unode_int> rr;  // Sampled RR set
+    auto reached = make_trial_sink(
+        [&rr](unode_int, unode_int target, unsigned int) {
+          rr.push_back(target);
+        }, false);
 
     double return_value = 1;
     int steps = 1;  // added for algorithm 2 line 1
@@ -127,28 +133,21 @@ class TIMEvaluator : public Evaluator {
       last_r = loop;
 
       for (int i = 0; i < loop; i++) {
-        std::shared_ptr<std::vector<unode_int>>
-            rr(new std::vector<unode_int>());
+        rr.clear();
         if (!incremental_) {
           std::unordered_set<unode_int> seeds;
           unode_int u = graph_nodes_[dst(gen_)];
           seeds.insert(u);
-          rr->push_back(u);
-          sampler.trial(graph, activated_, seeds, true);
-          for (TrialType tt : sampler.get_trials()) {
-            if (tt.trial == 1) {
-              rr->push_back(tt.target);
-            }
-          }
+          rr.push_back(u);
+          sampler.trial(graph, activated_, seeds, reached, true);
         } else {
-          rr = SampleManager::getInstance()->getSample(
+          auto sample = SampleManager::getInstance()->getSample(
               graph_nodes_, sampler, activated_, dst);
+          rr.assign(sample->begin(), sample->end());
         }
         double mg_tu = 0;
-        for (auto node : (*rr)) {
-          if (graph.has_neighbours(node,true)) {
-            mg_tu += graph.get_neighbours(node,true).size();
-          }
+        for (auto node : rr) {
+          mg_tu += graph.get_neighbours(node, true).size();
         }
         double pu = mg_tu / m_;
         c += 1 - pow(1 - pu, k_);
@@ -173,47 +172,42 @@ class TIMEvaluator : public Evaluator {
     hyper_g_.clear();
     hyper_g_.reserve(n_);
     for (unsigned int i = 0; i < n_; ++i) {
-      hyper_g_.push_back(std::shared_ptr<std::vector<unode_int>>(
-          new std::vector<unode_int>()));
+      hyper_g_.push_back(std::shared_ptr<LargeVector<unode_int>>(
+          new LargeVector<unode_int>()));
     }
 
     rr_sets_.clear();
     rr_sets_.reserve(R);
 
     double totTime = 0.0;
-    double totInDegree = 0;
+    // Only the reached nodes make the RR sets, failed trials are not drawn
+    auto reached = make_trial_sink(
+        [this](unode_int, unode_int target, unsigned int) {
+          rr_sets_.push_node(target);
+        }, false);
 
     for (unsigned int i = 0; i < R; i++) {
       if (!incremental_) {
-        std::shared_ptr<std::vector<unode_int>> rr(
-            new std::vector<unode_int>());
         std::unordered_set<unode_int> seeds;
         unode_int nd = graph_nodes_[dst(gen_)]; // Only RR set samples from unreached nodes
         seeds.insert(nd);
-        rr->push_back(nd);
+        rr_sets_.push_node(nd);
 
         timestamp_t t0, t1;
         t0 = get_timestamp();
-        sampler.trial(graph, activated_, seeds, true);
+        sampler.trial(graph, activated_, seeds, reached, true);
         t1 = get_timestamp();
         totTime += (double)(t1 - t0) / 1000000;
-
-        totInDegree += sampler.get_trials().size();
-        for (TrialType tt : sampler.get_trials()) {
-          if (tt.trial == 1) {
-            //deg[tt.target] += 1;
-            rr->push_back(tt.target);
-          }
-        }
-        rr_sets_.push_back(rr);
+        rr_sets_.close_set();
       } else {
-        rr_sets_.push_back(SampleManager::getInstance()->getSample(
-            graph_nodes_, sampler, activated_, dst));
+        auto sample = SampleManager::getInstance()->getSample(
+            graph_nodes_, sampler, activated_, dst);
+        rr_sets_.add(sample->begin(), sample->end());
       }
     }
 
     for (unsigned int i = 0; i < R; i++) {
-      for (unode_int t : (*rr_sets_[i])) {
+      for (unode_int t : rr_sets_[i]) {
         hyper_g_[t]->push_back(i);
       }
     }
@@ -237,7 +231,7 @@ class TIMEvaluator : public Evaluator {
       for (int t : (*hyper_g_[id])) {
         if (!visit_local[t]) {
           visit_local[t] = true;
-          for (int item : (*rr_sets_[t])) {
+          for (int item : rr_sets_[t]) {
             deg[item]--;
           }
         }
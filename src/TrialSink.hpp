@@ -0,0 +1,93 @@
+/*
+ Copyright (c) 2015 Siyu Lei, Silviu Maniu, Luyi Mo
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#ifndef __oim__TrialSink__
+#define __oim__TrialSink__
+
+#include <vector>
+
+#include "common.hpp"
+
+/**
+  Receives the trials of the edges tested by `Sampler::trial`, as they are
+  drawn, so that they can be consumed (applied to posteriors, counted...)
+  without being stored.
+*/
+class TrialSink {
+ public:
+  virtual ~TrialSink() {}
+
+  /**
+    Whether failed trials are given to `add`. If not, only the edges which
+    activate a node are, and samplers draw the live edges of a node at once
+    instead of testing each of them.
+  */
+  virtual bool wants_failures() const { return true; }
+
+  /**
+    Trial of the edge from `source` to `target`, `live` being 1 if it
+    activated `target` and 0 otherwise.
+  */
+  virtual void add(unode_int source, unode_int target, unsigned int live) = 0;
+};
+
+/**
+  Sink appending the trials to a vector (see `Sampler::get_trials`).
+*/
+class TrialLog : public TrialSink {
+ private:
+  std::vector<TrialType>& trials_;
+
+ public:
+  explicit TrialLog(std::vector<TrialType>& trials) : trials_(trials) {}
+
+  void add(unode_int source, unode_int target, unsigned int live) {
+    trials_.push_back({source, target, live});
+  }
+};
+
+/**
+  Sink calling `f(source, target, live)` for each trial, or for the live ones
+  only if `failures` is false (see `make_trial_sink`).
+*/
+template<typename F>
+class TrialCallback : public TrialSink {
+ private:
+  F f_;
+  bool failures_;
+
+ public:
+  TrialCallback(F f, bool failures) : f_(f), failures_(failures) {}
+
+  bool wants_failures() const { return failures_; }
+
+  void add(unode_int source, unode_int target, unsigned int live) {
+    f_(source, target, live);
+  }
+};
+
+template<typename F>
+TrialCallback<F> make_trial_sink(F f, bool failures=true) {
+  return TrialCallback<F>(f, failures);
+}
+
+#endif /* defined(__oim__TrialSink__) */
@@ -33,6 +33,10 @@
 #include <fstream>
 #include <string>
 #include <cstdint>
+#include <thread>
+#include <atomic>
+#include <ctime>
+#include <vector>
 
 
 #define THETA_OFFSET 5
@@ -43,6 +47,7 @@ extern double choosing_time;
 extern double reused_ratio;
 
 typedef uint32_t unode_int; // Type for node ids (can be changed into 32 or 64 bits)
+typedef uint32_t uedge_int; // Type for edge offsets in CSR graphs (idem)
 
 typedef struct {
   unode_int source;
@@ -50,13 +55,139 @@ typedef struct {
   unsigned int trial;
 } TrialType;
 
+#define STREAM_SEEDS 0  // Stages of the random streams (see `Philox`)
+#define STREAM_SNAPSHOTS 1
+#define STREAM_SAMPLES 2
+
+/**
+  Philox4x32-10 block function (Salmon et al., `Parallel Random Numbers: As
+  Easy as 1, 2, 3`, SC 2011): maps a 128-bit counter and a 64-bit key to 128
+  random bits, in place of the counter.
+*/
+inline void philox_block(uint32_t counter[4], uint32_t key0, uint32_t key1) {
+  for (int round = 0; round < 10; round++) {
+    uint64_t p0 = (uint64_t)0xD2511F53 * counter[0];
+    uint64_t p1 = (uint64_t)0xCD9E8D57 * counter[2];
+    uint32_t c1 = counter[1], c3 = counter[3];
+    counter[0] = (uint32_t)(p1 >> 32) ^ c1 ^ key0;
+    counter[1] = (uint32_t)p1;
+    counter[2] = (uint32_t)(p0 >> 32) ^ c3 ^ key1;
+    counter[3] = (uint32_t)p0;
+    key0 += 0x9E3779B9;
+    key1 += 0xBB67AE85;
+  }
+}
+
 /**
-  Builds a seed using nanoseconds to avoid same results.
+  Seed of the run, from which all the random numbers of the run are derived:
+  given by `--seed`, or else taken from the clock at the first use.
+*/
+class RunSeed {
+ private:
+  uint64_t seed_;
+  std::atomic<uint64_t> n_seeds_{0};  // Seeds given by `seed_ns`
+
+  RunSeed() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    seed_ = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  }
+
+ public:
+  static RunSeed& get_instance() {
+    static RunSeed instance;
+    return instance;
+  }
+
+  uint64_t get() const { return seed_; }
+
+  /**
+    Sets the seed and restarts the sequence of `seed_ns`.
+  */
+  void set(uint64_t seed) {
+    seed_ = seed;
+    n_seeds_ = 0;
+  }
+
+  uint64_t next_index() { return n_seeds_++; }
+};
+
+/**
+  Counter-based generator: the random stream of index `index` of a stage
+  (STREAM_*) under a key (the run seed by default) is the Philox blocks of
+  the counters (i, stage, index) for i = 0, 1, ... Streams are independent,
+  and each can be computed on its own, so that work split by sample index
+  gets the same numbers whatever the thread running it.
+*/
+class Philox {
+ public:
+  Philox(uint32_t stage, uint64_t index,
+         uint64_t key = RunSeed::get_instance().get())
+      : key0_((uint32_t)key), key1_((uint32_t)(key >> 32)),
+        stage_(stage), index_(index) {}
+
+  inline int gen_int() {
+    if (pos_ == 4) {
+      block_[0] = next_++;
+      block_[1] = stage_;
+      block_[2] = (uint32_t)index_;
+      block_[3] = (uint32_t)(index_ >> 32);
+      philox_block(block_, key0_, key1_);
+      pos_ = 0;
+    }
+    return (int)block_[pos_++];
+  }
+
+  inline uint64_t gen_uint64() {
+    return ((uint64_t)(uint32_t)gen_int() << 32) | (uint32_t)gen_int();
+  }
+
+  inline int gen_int(int n) {
+    return (int) (n * gen_double());
+  }
+
+  inline double gen_double() {
+    return (gen_uint64() >> 11) * (1.0 / (1ULL << 53));
+  }
+
+ private:
+  uint32_t key0_, key1_;
+  uint32_t stage_;
+  uint64_t index_;
+  uint32_t next_ = 0;  // Counter of the next block
+  uint32_t block_[4];
+  unsigned int pos_ = 4;  // Next value of `block_`
+};
+
+/**
+  Seed of a generator. Seeds are the successive values of the stream
+  STREAM_SEEDS of the run seed, so that a run is reproduced by giving its
+  seed again, generators being created in the same order.
 */
 int seed_ns() {
-  struct timespec ts;
-  clock_gettime(CLOCK_MONOTONIC, &ts);
-  return (int)ts.tv_nsec;
+  return Philox(STREAM_SEEDS, RunSeed::get_instance().next_index()).gen_int();
+}
+
+/**
+  Number of threads used by parallel loops.
+*/
+unsigned int hardware_threads() {
+  unsigned int n_threads = std::thread::hardware_concurrency();
+  return (n_threads > 0) ? n_threads : 1;
+}
+
+/**
+  Splits [0, n) in `n_threads` contiguous chunks and calls `f(t, begin, end)`
+  on chunk t in its own thread.
+*/
+template<typename F>
+void parallel_chunks(size_t n, unsigned int n_threads, F f) {
+  std::vector<std::thread> threads;
+  for (unsigned int t = 1; t < n_threads; t++)
+    threads.emplace_back(f, t, n * t / n_threads, n * (t + 1) / n_threads);
+  f(0, 0, n / n_threads);
+  for (auto& thread : threads)
+    thread.join();
 }
 
 typedef unode_int long timestamp_t;
@@ -25,31 +25,96 @@
 
 #include <iostream>
 #include <fstream>
+#include <string>
 
 #include "InfluenceDistribution.hpp"
 #include "SingleInfluence.hpp"
 #include "BetaInfluence.hpp"
 #include "Graph.hpp"
 
+/**
+  If true, loaded graphs are compressed (see `Graph::compress`), which is set
+  by the `--compress` option.
+*/
+bool compress_graphs = false;
 
 /**
-  Load the graph from file and returns the number of nodes
+  If true, nodes of loaded graphs are renumbered for locality (see
+  `Graph::reorder_nodes`), which is set by the `--reorder` option.
+*/
+bool reorder_graphs = false;
+
+/**
+  If true, known influence probabilities of loaded graphs are stored in fixed
+  point (see `EdgeParameters::quantize`), which is set by the `--quantize`
+  option.
+*/
+bool quantize_graphs = false;
+
+/**
+  If true, lists of edges are read as undirected graphs, stored in a symmetric
+  layout (see `Graph::assign_undirected_edges`), which is set by the
+  `--undirected` option.
+*/
+bool undirected_graphs = false;
+
+/**
+  Weight model replacing the influence probabilities of loaded graphs, which
+  are then computed instead of being stored by edge: "wc" for the weighted
+  cascade model (see `Graph::use_weighted_cascade`, also the uniform LT
+  model), or a constant probability (see `Graph::use_constant_influence`). It
+  is set by the `--weights` option, and empty if probabilities are read.
+*/
+std::string weight_model;
+
+/**
+  Reads `graph` from `filename`, either a list of edges, parsed in parallel
+  (see `EdgeListParser`), or a binary graph (see `Graph::save_binary`).
+*/
+void read_graph(const std::string& filename, Graph& graph) {
+  if (Graph::is_binary_file(filename))
+    graph.load_binary(filename);
+  else if (undirected_graphs)
+    graph.assign_undirected_edges(EdgeListParser().parse(filename));
+  else
+    graph.assign_edges(EdgeListParser().parse(filename));
+}
+
+/**
+  Reorders, applies the weight model, quantizes and compresses `graph` if
+  asked, and reports the memory of its adjacency and the allocation of its
+  large arrays (see `LargeMemory`).
+*/
+void prepare_graph(Graph& graph) {
+  if (reorder_graphs)
+    graph.reorder_nodes();
+  if (weight_model == "wc")
+    graph.use_weighted_cascade();
+  else if (!weight_model.empty())
+    graph.use_constant_influence(std::stod(weight_model));
+  if (quantize_graphs)
+    graph.quantize();
+  if (compress_graphs) {
+    size_t memory = graph.adjacency_memory();
+    graph.compress();
+    std::cerr << "Compressed adjacency from " << memory / (1024 * 1024)
+              << " MB to " << graph.adjacency_memory() / (1024 * 1024)
+              << " MB" << std::endl;
+  }
+  if (LargeMemory::get_instance().is_enabled())
+    LargeMemory::get_instance().report(std::cerr);
+}
+
+/**
+  Load the graph from file and returns the number of edges (see `read_graph`).
 */
 unode_int load_original_graph(
       std::string filename, Graph& graph, int model=1) {
-  std::ifstream file(filename);
-  unode_int src, tgt;
-  double prob;
-  unode_int edges = 0;
-  while (file >> src >> tgt >> prob) {
-    std::shared_ptr<InfluenceDistribution> dst_original(
-        new SingleInfluence(prob));
-    graph.add_edge(src, tgt, dst_original);
-    edges++;
-  }
+  read_graph(filename, graph);
+  prepare_graph(graph);
   if (model == 0) // If LT model, we need to create distributions for each nodes
     graph.build_lt_distribution(INFLUENCE_MED);
-  return edges;
+  return graph.get_number_edges();
 }
 
 /**
@@ -60,25 +125,19 @@ unode_int load_original_graph(
 unode_int load_model_and_original_graph(
       std::string filename, double alpha, double beta,
       Graph& original_graph, Graph& model_graph, int model=1) {
-  std::ifstream file(filename);
-  unode_int src, tgt;
-  double prob;
-  unode_int edges = 0;
-  while (file >> src >> tgt >> prob) {
-    std::shared_ptr<InfluenceDistribution> dst_original(
-        new SingleInfluence(prob));
-    std::shared_ptr<InfluenceDistribution> dst_model(
-        new BetaInfluence(alpha, beta, prob));
-    original_graph.add_edge(src, tgt, dst_original);
-    model_graph.add_edge(src, tgt, dst_model);
-    edges++;
-  }
+  read_graph(filename, original_graph);
+  prepare_graph(original_graph);
+  model_graph = original_graph;  // Shares the topology (and mapped file)
+  model_graph.set_edge_parameters(EdgeParameters::beta_posteriors(
+      original_graph.get_edge_parameters(), alpha, beta));
   if (model == 0) { // If LT model, we need to create distributions for each nodes
     original_graph.build_lt_distribution(INFLUENCE_MED);
-    // Not for model graph as it is used only by expg that does not handle LT
+    // Rebuilt for the updated targets after each stage of trials (see
+    // Graph::apply_trials)
+    model_graph.build_lt_distribution(INFLUENCE_MED);
   }
   model_graph.set_prior(alpha, beta);
-  return edges;
+  return original_graph.get_number_edges();
 }
 
 #endif /* defined(__oim__graph_utils__) */
@@ -70,7 +70,7 @@ void real(int argc, const char * argv[],
   std::shared_ptr<LogDiffusion> log_diffusion;
   if (argc > 8) {
     log_diffusion = std::make_unique<LogDiffusion>();
-    log_diffusion->load_cascades(argv[7]);
+    log_diffusion->load_cascades(argv[7], original_graph);
   }
   OriginalGraphStrategy strategy(original_graph, *evaluators.at(exploit),
                                  samples, model, log_diffusion);
@@ -111,7 +111,7 @@ void expgr(int argc, const char * argv[],
   std::unique_ptr<LogDiffusion> log_diffusion;
   if (argc > 11) {
     log_diffusion = std::make_unique<LogDiffusion>();
-    log_diffusion->load_cascades(argv[11]);
+    log_diffusion->load_cascades(argv[11], original_graph);
   }
   // Run experiment with Exponentiated Gradient strategy
   ExponentiatedGradientStrategy strategy(
@@ -159,7 +159,7 @@ void missing_mass(int argc, const char * argv[],
   if (argc > 9) {
     std::cerr << "Loading of cascades from logs..." << std::endl;
     log_diffusion = std::make_unique<LogDiffusion>();
-    log_diffusion->load_cascades(argv[9]);
+    log_diffusion->load_cascades(argv[9], original_graph);
   }
 
   MissingMassStrategy strategy(original_graph, *greduction.at(reduction),
@@ -169,7 +169,73 @@ void missing_mass(int argc, const char * argv[],
   strategy.perform(budget, k);
 }
 
+/**
+  Function converting a graph given as a list of edges into the binary format,
+  which is then loaded instantly by the other experiments.
+
+  Ex. usage: ./oim --convert graph.txt graph.bin
+*/
+void convert(int argc, const char * argv[]) {
+  if (argc < 4) {
+    std::cerr << "Wrong number of arguments.\n\tUsage ./oim --convert "
+              << "<graph> <binary graph>" << std::endl;
+    exit(1);
+  }
+  Graph graph;
+  load_original_graph(argv[2], graph);
+  graph.save_binary(argv[3]);
+  std::cerr << "Saved " << graph.get_number_nodes() << " nodes and "
+            << graph.get_number_edges() << " edges to " << argv[3]
+            << std::endl;
+}
+
 int main(int argc, const char * argv[]) {
+  double rel_error = 0;  // Relative error of the spreads of CELF, if positive
+  bool static_greedy = false;  // Whether CELF evaluates spreads on snapshots
+  // Options of the run, parsed before any generator exists (for the seed)
+  for (; argc > 1; argc--, argv++) {
+    if (std::string(argv[1]) == "--compress")
+      compress_graphs = true;
+    else if (std::string(argv[1]) == "--reorder")
+      reorder_graphs = true;
+    else if (std::string(argv[1]) == "--quantize")
+      quantize_graphs = true;
+    else if (std::string(argv[1]) == "--undirected")
+      undirected_graphs = true;
+    else if (std::string(argv[1]) == "--hugepages")
+      LargeMemory::get_instance().set_huge_pages(true);
+    else if (std::string(argv[1]) == "--interleave")
+      LargeMemory::get_instance().set_interleave(true);
+    else if (std::string(argv[1]) == "--weights" && argc > 2) {
+      weight_model = argv[2];
+      argc--, argv++;
+    } else if (std::string(argv[1]) == "--rel_error" && argc > 2) {
+      rel_error = std::stod(argv[2]);
+      argc--, argv++;
+    } else if (std::string(argv[1]) == "--static_greedy") {
+      static_greedy = true;
+    } else if (std::string(argv[1]) == "--seed" && argc > 2) {
+      RunSeed::get_instance().set(std::stoull(argv[2]));
+      argc--, argv++;
+    } else
+      break;
+  }
+  if (argc < 2) {
+    std::cerr << "Usage ./oim [--compress] [--reorder] [--quantize] "
+              << "[--undirected] [--weights wc|<p>] [--hugepages] "
+              << "[--interleave] [--seed <seed>] [--rel_error <e>] "
+              << "[--static_greedy] "
+              << "--real|--eg|--missing_mass|--convert ..."
+              << std::endl;
+    exit(1);
+  }
+  std::cerr << "Seed: " << RunSeed::get_instance().get() << std::endl;
+
+  // Snapshots of the model graph, drawn once for all the evaluators selecting
+  // on it (snapshots are kept by influence type only, so that evaluators of
+  // other graphs have their own)
+  auto snapshots = std::make_shared<SnapshotStore>(200);
+
   // Vector of different GraphReduction implementations
   std::vector<unique_ptr<GraphReduction>> greductions;
   greductions.push_back(std::unique_ptr<GraphReduction>(
@@ -187,13 +253,23 @@ int main(int argc, const char * argv[]) {
   evaluators.push_back(std::unique_ptr<Evaluator>(new RandomEvaluator()));
   evaluators.push_back(std::unique_ptr<Evaluator>(new DiscountDegreeEvaluator()));
   evaluators.push_back(std::unique_ptr<Evaluator>(new HighestDegreeEvaluator()));
-  evaluators.push_back(std::unique_ptr<Evaluator>(new CELFEvaluator(100)));
+  // CELF takes 100 samples per spread, or up to 1000 until `rel_error`, or
+  // evaluates spreads on the snapshots
+  if (static_greedy)
+    evaluators.push_back(std::unique_ptr<Evaluator>(
+        new CELFEvaluator(snapshots)));
+  else
+    evaluators.push_back(std::unique_ptr<Evaluator>(
+        new CELFEvaluator((rel_error > 0) ? 1000 : 100, rel_error)));
   evaluators.push_back(std::unique_ptr<Evaluator>(new TIMEvaluator()));
   evaluators.push_back(std::unique_ptr<Evaluator>(new SSAEvaluator(0.1)));
-  evaluators.push_back(std::unique_ptr<Evaluator>(new PMCEvaluator(200)));
+  evaluators.push_back(std::unique_ptr<Evaluator>(new PMCEvaluator(snapshots)));
 
   std::string experiment(argv[1]);
   if (experiment == "--real") real(argc, argv, evaluators);
   else if (experiment == "--eg") expgr(argc, argv, evaluators);
   else if (experiment == "--missing_mass") missing_mass(argc, argv, greductions);
+  else if (experiment == "--convert") convert(argc, argv);
+  if (LargeMemory::get_instance().is_enabled())
+    LargeMemory::get_instance().report(std::cerr);
 }
@@ -3,7 +3,24 @@
 
 #include "../Graph.hpp"
 #include "../graph_utils.hpp"
+#include "../GraphView.hpp"
 #include "../GraphReduction.hpp"
+#include "../CELFEvaluator.hpp"
+#include "../PMCEvaluator.hpp"
+
+// Edges of `u` in `graph` as (target, influence) pairs sorted by target, so
+// that graphs with different layouts can be compared. If `mapped`, `u` and
+// the targets are ids of the input graph (see `Graph::internal_id`).
+static std::vector<std::pair<unode_int, double>> edges_of(
+    const Graph& graph, unode_int u, bool inv, bool mapped=false) {
+  std::vector<std::pair<unode_int, double>> edges;
+  for (auto& edge : graph.get_neighbours(mapped ? graph.internal_id(u) : u,
+                                         inv))
+    edges.push_back({mapped ? graph.original_id(edge.target) : edge.target,
+                     graph.get_influence(edge, INFLUENCE_MED)});
+  std::sort(edges.begin(), edges.end());
+  return edges;
+}
 
 // Test the graph structure and the loading of a graph
 TEST_CASE( "GRAPH LOADED", "[graph loading]" ) {
@@ -19,6 +36,774 @@ TEST_CASE( "GRAPH LOADED", "[graph loading]" ) {
   REQUIRE(graph.get_neighbours(0, true).size() == 1);
 }
 
+// Test the compressed sparse row layout of a loaded graph, and that going back
+// to hash maps keeps the same structure
+TEST_CASE( "FROZEN GRAPH", "[frozen graph]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  REQUIRE(graph.is_frozen() == true);
+  REQUIRE(graph.get_neighbours(2).size() == 4);
+  REQUIRE(graph.get_neighbours(2)[3].target == 7);
+  REQUIRE(graph.get_neighbours(7, true)[0].target == 2);
+  REQUIRE(graph.get_neighbours(7).empty() == true);
+  REQUIRE(graph.has_neighbours(42) == false);
+  REQUIRE(graph.get_neighbours(42, true).size() == 0);
+  Graph copy_graph(graph);
+  copy_graph.thaw();
+  REQUIRE(copy_graph.is_frozen() == false);
+  for (unode_int u = 0; u < graph.get_number_nodes(); u++) {
+    REQUIRE(copy_graph.has_neighbours(u) == graph.has_neighbours(u));
+    REQUIRE(copy_graph.get_neighbours(u, true).size()
+            == graph.get_neighbours(u, true).size());
+  }
+}
+
+// Test the influence parameters stored by edge id, for both the real graph and
+// the model graph (Beta posteriors)
+TEST_CASE( "EDGE PARAMETERS", "[edge parameters]" ) {
+  Graph original_graph, model_graph;
+  load_model_and_original_graph("datasets/graph_test.csv", 1, 1,
+                                original_graph, model_graph);
+  auto edge = original_graph.get_neighbours(0)[0];  // Edge (0, 1)
+  REQUIRE(edge.target == 1);
+  REQUIRE(original_graph.get_influence(edge, INFLUENCE_MED) == Approx(0.08));
+  REQUIRE(original_graph.get_neighbours(1, true)[0].id == edge.id);
+  REQUIRE(model_graph.get_influence(edge, INFLUENCE_MED) == Approx(0.5));
+  model_graph.update_edge(0, 1, 1);
+  model_graph.update_edge(0, 1, 1);
+  const EdgeParameters& params = model_graph.get_edge_parameters();
+  REQUIRE(params.get_hits(edge.id) == 2);
+  REQUIRE(params.get_misses(edge.id) == 0);
+  REQUIRE(params.mean(edge.id, 1) == Approx(0.75));
+  REQUIRE(params.mean(model_graph.get_neighbours(0)[1].id, 0)
+          == Approx(0.5));
+  REQUIRE(params.sq_error(edge.id, 1) == Approx((0.75 - 0.08) * (0.75 - 0.08)));
+  model_graph.update_edge_priors(2, 1);
+  REQUIRE(params.mean(edge.id, 1) == Approx(0.8));
+  // Constant weight layer over the same topology
+  Graph constant_graph(original_graph);
+  constant_graph.set_edge_parameters(EdgeParameters::constant(
+      original_graph.get_edge_parameters().size(), 0.3));
+  REQUIRE(constant_graph.get_neighbours(0)[0].target == 1);
+  REQUIRE(constant_graph.get_influence(edge, INFLUENCE_MED) == Approx(0.3));
+  REQUIRE(original_graph.get_influence(edge, INFLUENCE_MED) == Approx(0.08));
+}
+
+// Test that the parallel parsing and building of a graph gives the same graph
+// as adding its edges one by one
+TEST_CASE( "PARALLEL LOADING", "[parallel loading]" ) {
+  Graph graph, parsed_graph;
+  std::ifstream file("datasets/graph_test.csv");
+  unode_int src, tgt;
+  double prob;
+  while (file >> src >> tgt >> prob)
+    graph.add_edge(src, tgt, prob);
+  graph.freeze();
+  EdgeList edges = EdgeListParser(3).parse("datasets/graph_test.csv");
+  REQUIRE(edges.size() == 14);
+  parsed_graph.assign_edges(edges, 3);
+  REQUIRE(parsed_graph.get_number_nodes() == graph.get_number_nodes());
+  REQUIRE(parsed_graph.get_number_edges() == graph.get_number_edges());
+  for (auto u : graph.get_nodes()) {
+    for (bool inv : {false, true}) {
+      auto lst = graph.get_neighbours(u, inv);
+      auto parsed_lst = parsed_graph.get_neighbours(u, inv);
+      REQUIRE(parsed_lst.size() == lst.size());
+      for (size_t i = 0; i < lst.size(); i++) {
+        REQUIRE(parsed_lst[i].target == lst[i].target);
+        REQUIRE(parsed_lst[i].id == lst[i].id);
+        REQUIRE(parsed_graph.get_influence(parsed_lst[i], INFLUENCE_MED)
+                == graph.get_influence(lst[i], INFLUENCE_MED));
+      }
+    }
+  }
+}
+
+// Test that a compressed graph has the same edges (lists are sorted by
+// target), and that it can still be modified (in the delta)
+TEST_CASE( "COMPRESSED GRAPH", "[compressed graph]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  Graph compressed_graph(graph);
+  compressed_graph.compress();
+  REQUIRE(compressed_graph.is_compressed() == true);
+  REQUIRE(compressed_graph.adjacency_memory() < graph.adjacency_memory());
+  for (auto u : graph.get_nodes()) {
+    REQUIRE(edges_of(compressed_graph, u, false) == edges_of(graph, u, false));
+    REQUIRE(edges_of(compressed_graph, u, true) == edges_of(graph, u, true));
+  }
+  REQUIRE(compressed_graph.get_neighbours(2)[3].target == 7);
+  REQUIRE(compressed_graph.get_neighbours(7, true)[0].id
+          == compressed_graph.get_neighbours(2)[3].id);
+  compressed_graph.remove_node(3);
+  REQUIRE(compressed_graph.is_compressed() == true);
+  REQUIRE(compressed_graph.get_delta_size() == 4);
+  REQUIRE(compressed_graph.get_number_edges() == 10);
+  REQUIRE(compressed_graph.get_neighbours(2).size() == 3);
+}
+
+// Test that a reordered graph is the same graph up to the renumbering of its
+// nodes, which is kept in binary files
+TEST_CASE( "REORDERED GRAPH", "[reordered graph]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  Graph reordered_graph(graph);
+  reordered_graph.reorder_nodes();
+  REQUIRE(reordered_graph.get_number_nodes() == graph.get_number_nodes());
+  REQUIRE(reordered_graph.get_number_edges() == graph.get_number_edges());
+  REQUIRE(reordered_graph.get_neighbours(0).size() == 4);  // Node 2 comes first
+  REQUIRE(reordered_graph.original_id(0) == 2);
+  for (auto u : graph.get_nodes()) {
+    REQUIRE(reordered_graph.original_id(reordered_graph.internal_id(u)) == u);
+    REQUIRE(edges_of(reordered_graph, u, false, true)
+            == edges_of(graph, u, false, true));
+    REQUIRE(edges_of(reordered_graph, u, true, true)
+            == edges_of(graph, u, true, true));
+  }
+  REQUIRE(reordered_graph.internal_id(42) == 42);
+  reordered_graph.save_binary("datasets/graph_test_reordered.bin");
+  Graph binary_graph;
+  load_original_graph("datasets/graph_test_reordered.bin", binary_graph);
+  for (auto u : graph.get_nodes())
+    REQUIRE(edges_of(binary_graph, u, false, true)
+            == edges_of(graph, u, false, true));
+  std::remove("datasets/graph_test_reordered.bin");
+}
+
+// Test the fixed-point influence probabilities and their sampling with a
+// single random integer
+TEST_CASE( "QUANTIZED GRAPH", "[quantized graph]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.quantize();
+  const EdgeParameters& params = graph.get_edge_parameters();
+  REQUIRE(params.get_kind() == PARAMETERS_FIXED);
+  auto edge = graph.get_neighbours(0)[0];  // Edge (0, 1)
+  REQUIRE(graph.get_influence(edge, INFLUENCE_MED) == Approx(0.08).margin(1e-9));
+  Xorshift rng(42);
+  unsigned int live = 0;
+  for (int i = 0; i < 100000; i++)
+    live += params.sample_live(edge.id, 1, INFLUENCE_MED, rng);
+  REQUIRE(live / 100000.0 == Approx(0.08).margin(0.005));
+  graph.add_edge(7, 0, 1.0);  // New edges are quantized too
+  graph.add_edge(7, 1, 0.0);
+  graph.freeze();
+  unsigned int live_sure = 0, live_never = 0;
+  for (int i = 0; i < 1000; i++) {
+    live_sure += params.sample_live(graph.get_neighbours(7)[0].id, 0, 0, rng);
+    live_never += params.sample_live(graph.get_neighbours(7)[1].id, 1, 0, rng);
+  }
+  REQUIRE(live_sure == 1000);
+  REQUIRE(live_never == 0);
+  // An influence of 1 is exact, and live even for the largest random integer
+  auto sure_edge = graph.get_neighbours(7)[0];
+  REQUIRE(graph.get_influence(sure_edge, INFLUENCE_MED) == 1.0);
+  struct MaxRandom {
+    int gen_int() { return -1; }  // 2^32 - 1 as a 32-bit integer
+    uint64_t gen_uint64() { return ~0ULL; }
+    double gen_double() { return 1.0 - 1e-12; }
+    typedef uint32_t result_type;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+    result_type operator()() { return UINT32_MAX; }
+    const uint32_t* gen_block(unsigned int) { return block_; }
+    uint32_t block_[64];
+    MaxRandom() { std::fill(block_, block_ + 64, UINT32_MAX); }
+  } max_random;
+  REQUIRE(params.sample_live(sure_edge.id, 0, 0, max_random) == true);
+  REQUIRE(params.live_edges(&sure_edge, 1, false, 0, max_random) == 1);
+  REQUIRE(params.live_mask(sure_edge.id, 0, 0, ~0ULL, max_random) == ~0ULL);
+  graph.use_constant_influence(1.0);
+  const EdgeParameters& constant = graph.get_edge_parameters();
+  REQUIRE(constant.sample_live(sure_edge.id, 0, 0, max_random) == true);
+  REQUIRE(constant.live_edges(&sure_edge, 1, false, 0, max_random) == 1);
+}
+
+// Test that the updates of a frozen graph (in its delta) give the same graph
+// as the updates of the hash maps, before and after compaction
+TEST_CASE( "DYNAMIC GRAPH", "[dynamic graph]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  Graph mutable_graph(graph);
+  mutable_graph.thaw();
+  for (Graph* g : {&graph, &mutable_graph}) {
+    g->add_edge(7, 0, 0.5);
+    g->add_edge(8, 2, 0.25);
+    g->remove_edge(2, 7);
+    g->remove_node(4);
+  }
+  REQUIRE(graph.is_frozen() == true);
+  REQUIRE(graph.get_delta_size() > 0);
+  for (int compacted = 0; compacted < 2; compacted++) {
+    REQUIRE(graph.get_number_nodes() == mutable_graph.get_number_nodes());
+    REQUIRE(graph.get_number_edges() == mutable_graph.get_number_edges());
+    for (unode_int u = 0; u < 10; u++) {
+      REQUIRE(graph.has_node(u) == mutable_graph.has_node(u));
+      REQUIRE(graph.has_neighbours(u) == mutable_graph.has_neighbours(u));
+      REQUIRE(graph.get_neighbours(u, true).size()
+              == mutable_graph.get_neighbours(u, true).size());
+      REQUIRE(edges_of(graph, u, false) == edges_of(mutable_graph, u, false));
+      REQUIRE(edges_of(graph, u, true) == edges_of(mutable_graph, u, true));
+    }
+    graph.compact();
+    REQUIRE(graph.get_delta_size() == 0);
+  }
+}
+
+// Test the lookup of edge ids and the batched update of posteriors
+TEST_CASE( "EDGE INDEX", "[edge index]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  Graph compressed_graph(graph);
+  compressed_graph.compress();
+  for (Graph* g : {&graph, &compressed_graph}) {
+    unsigned int n_found = 0;
+    for (auto u : g->get_nodes())
+      for (auto& edge : g->get_neighbours(u))
+        n_found += (g->find_edge(u, edge.target) == edge.id);
+    REQUIRE(n_found == 14);
+    REQUIRE(g->find_edge(2, 0) == NO_EDGE);
+    g->add_edge(2, 0, 0.5);
+    REQUIRE(g->find_edge(2, 0) != NO_EDGE);
+    g->remove_edge(2, 0);
+    REQUIRE(g->find_edge(2, 0) == NO_EDGE);
+  }
+  Graph model_graph(graph), updated_graph(graph);
+  for (Graph* g : {&model_graph, &updated_graph})
+    g->set_edge_parameters(EdgeParameters::beta_posteriors(
+        graph.get_edge_parameters(), 1, 1));
+  std::vector<TrialType> trials = {{2, 3, 1}, {3, 4, 0}, {2, 3, 0}, {2, 3, 1}};
+  model_graph.apply_trials(trials);
+  for (auto& tt : trials)
+    updated_graph.update_edge(tt.source, tt.target, tt.trial);
+  const EdgeParameters& params = model_graph.get_edge_parameters();
+  uedge_int id = model_graph.find_edge(2, 3);
+  REQUIRE(params.get_hits(id) == 2);
+  REQUIRE(params.get_misses(id) == 1);
+  REQUIRE(params.get_misses(model_graph.find_edge(3, 4)) == 1);
+  for (uedge_int e = 0; e < params.size(); e++) {
+    REQUIRE(params.get_hits(e)
+            == updated_graph.get_edge_parameters().get_hits(e));
+    REQUIRE(params.mean(e, 0)
+            == Approx(updated_graph.get_edge_parameters().mean(e, 0)));
+  }
+}
+
+// Test the sampling of live edges of the LT model by alias tables, and their
+// incremental rebuild when posteriors are updated
+TEST_CASE( "LT DISTRIBUTION", "[lt distribution]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph, 0);
+  auto frequencies = [](const Graph& g, unode_int u) {
+    boost::mt19937 gen(42);
+    std::vector<double> freq(g.get_neighbours(u, true).size() + 1, 0);
+    for (int i = 0; i < 100000; i++) {
+      int index = g.sample_living_edge(u, gen);
+      freq[(index == -1) ? freq.size() - 1 : index] += 1e-5;
+    }
+    return freq;
+  };
+  // Node 2 has incoming edges from 0 (0.1) and 3 (0.07)
+  std::vector<double> freq = frequencies(graph, 2);
+  REQUIRE(freq.size() == 3);
+  REQUIRE(freq[0] + freq[1] == Approx(0.17).epsilon(0.05));
+  REQUIRE(freq[2] == Approx(0.83).epsilon(0.01));
+  Graph model_graph(graph);
+  model_graph.set_edge_parameters(EdgeParameters::beta_posteriors(
+      graph.get_edge_parameters(), 1, 1));
+  model_graph.build_lt_distribution(INFLUENCE_MED);
+  model_graph.apply_trials({{0, 2, 1}, {0, 2, 1}, {3, 2, 0}});
+  // Means are 3/4 and 1/3, weights are normalized as they exceed 1
+  unsigned int from_0 = (model_graph.get_neighbours(2, true)[0].target == 0)
+      ? 0 : 1;
+  freq = frequencies(model_graph, 2);
+  REQUIRE(freq[from_0] == Approx(9. / 13).epsilon(0.02));
+  REQUIRE(freq[1 - from_0] == Approx(4. / 13).epsilon(0.02));
+  REQUIRE(freq[2] == 0);
+}
+
+// Test the weight models computed from the topology instead of being stored
+TEST_CASE( "WEIGHT MODELS", "[weight models]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.use_weighted_cascade();
+  const EdgeParameters& params = graph.get_edge_parameters();
+  REQUIRE(params.get_kind() == PARAMETERS_DEGREE);
+  REQUIRE(params.size() == 14);
+  auto edge = graph.get_neighbours(0)[0];  // Edge (0, 1), node 1 has 3 parents
+  REQUIRE(graph.get_influence(edge, INFLUENCE_MED) == Approx(1. / 3));
+  auto inv_edge = graph.get_neighbours(1, true)[0];
+  REQUIRE(graph.get_influence(inv_edge, INFLUENCE_MED, true) == Approx(1. / 3));
+  REQUIRE(graph.get_influence(graph.get_neighbours(3)[1], 0) == Approx(0.5));
+  Xorshift rng(42);
+  unsigned int live = 0;
+  for (int i = 0; i < 100000; i++)
+    live += params.sample_live(edge.id, 1, INFLUENCE_MED, rng);
+  REQUIRE(live / 100000.0 == Approx(1. / 3).margin(0.005));
+  // Uniform LT model: a parent of node 1 is always chosen
+  graph.build_lt_distribution(INFLUENCE_MED);
+  boost::mt19937 gen(42);
+  unsigned int no_edge = 0;
+  for (int i = 0; i < 1000; i++)
+    no_edge += (graph.sample_living_edge(1, gen) == -1);
+  REQUIRE(no_edge == 0);
+  // Model graph over the weighted cascade
+  Graph model_graph(graph);
+  model_graph.set_edge_parameters(EdgeParameters::beta_posteriors(
+      params, 1, 1));
+  REQUIRE(model_graph.get_edge_parameters().sq_error(edge.id, 1)
+          == Approx((0.5 - 1. / 3) * (0.5 - 1. / 3)));
+  // In-degrees follow the modifications of the graph
+  graph.add_edge(7, 1, 0.9);
+  REQUIRE(graph.get_influence(edge, INFLUENCE_MED) == Approx(0.25));
+  graph.remove_node(2);
+  REQUIRE(graph.get_influence(edge, INFLUENCE_MED) == Approx(1. / 3));
+  graph.compact();
+  REQUIRE(graph.get_influence(graph.get_neighbours(0)[0], 0) == Approx(1. / 3));
+  FlatArray<double> values = graph.get_known_values();
+  REQUIRE(values.size() == graph.get_edge_parameters().size());
+  // Constant influence
+  graph.use_constant_influence(0.2);
+  REQUIRE(graph.get_edge_parameters().get_kind() == PARAMETERS_CONSTANT);
+  REQUIRE(graph.get_influence(graph.get_neighbours(0)[0], 0) == Approx(0.2));
+  live = 0;
+  for (int i = 0; i < 100000; i++)
+    live += graph.get_edge_parameters().sample_live(0, 1, 0, rng);
+  REQUIRE(live / 100000.0 == Approx(0.2).margin(0.005));
+  for (double value : graph.get_known_values())
+    REQUIRE(value == Approx(0.2));
+}
+
+// Test the huge-page allocation of large arrays, and that graphs built with it
+// are identical
+TEST_CASE( "LARGE ALLOCATOR", "[large allocator]" ) {
+  LargeMemory& memory = LargeMemory::get_instance();
+  struct HugePages {  // Enables huge pages until destroyed, even on a failure
+    HugePages() { LargeMemory::get_instance().set_huge_pages(true); }
+    ~HugePages() { LargeMemory::get_instance().set_huge_pages(false); }
+  };
+  size_t mapped_bytes = memory.get_mapped_bytes();
+  size_t n_mappings = memory.get_number_mappings();
+  std::unique_ptr<HugePages> huge_pages(new HugePages());
+  LargeVector<uedge_int> values(HUGE_PAGE_SIZE, 1);  // 8 MB, mapped apart
+  REQUIRE((uintptr_t)values.data() % HUGE_PAGE_SIZE == 0);
+  REQUIRE(memory.is_mapped(values.data()) == true);
+  REQUIRE(memory.get_mapped_bytes() - mapped_bytes == 8 * 1024 * 1024);
+  REQUIRE(memory.get_number_mappings() - n_mappings == 1);
+  LargeVector<uedge_int> small(16, 2);  // Usual allocator
+  REQUIRE(memory.is_mapped(small.data()) == false);
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  huge_pages.reset();  // Arrays mapped before are still released
+  void* mapped = values.data();
+  values.clear();
+  values.shrink_to_fit();
+  REQUIRE(memory.is_mapped(mapped) == false);
+  Graph usual_graph;
+  load_original_graph("datasets/graph_test.csv", usual_graph);
+  REQUIRE(graph.get_number_edges() == usual_graph.get_number_edges());
+  for (auto node : usual_graph.get_nodes())
+    REQUIRE(graph.get_neighbours(node).size()
+            == usual_graph.get_neighbours(node).size());
+  REQUIRE(memory.get_number_mappings() - n_mappings == 1);
+  std::ostringstream report;
+  memory.report(report);
+  REQUIRE(report.str().find("Large arrays: ") == 0);
+}
+
+// Test the cascades of SpreadSampler, which reuse their scratch space
+TEST_CASE( "SPREAD SAMPLER", "[spread sampler]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.use_constant_influence(1.0);  // Cascades reach all descendants
+  SpreadSampler sampler(INFLUENCE_MED, 1);
+  REQUIRE(sampler.sample(graph, {}, {0}, 10) == 8);
+  REQUIRE(sampler.sample(graph, {1, 2}, {0}, 10) == 6);
+  REQUIRE(sampler.sample(graph, {}, {7}, 10) == 1);
+  REQUIRE(sampler.perform_diffusion(graph, {7, 5}).size() == 8);
+  REQUIRE(sampler.trial(graph, {}, {3}) == 8);
+  REQUIRE(sampler.get_trials().size() == 7);  // One live edge per new node
+  graph.use_constant_influence(0.0);
+  REQUIRE(sampler.sample(graph, {}, {0, 3}, 10) == 2);
+  REQUIRE(sampler.perform_diffusion(graph, {2}).size() == 1);
+}
+
+// Test that trials are given to sinks, failed trials being drawn only if the
+// sink wants them
+TEST_CASE( "TRIAL SINK", "[trial sink]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.use_constant_influence(0.5);
+  SpreadSampler sampler(INFLUENCE_MED, 1);
+  unsigned int n_trials = 0, n_live = 0, n_failures = 0;
+  auto all = make_trial_sink([&](unode_int, unode_int, unsigned int live) {
+    n_trials++;
+    n_live += live;
+  });
+  double spread = 0;
+  for (int i = 0; i < 100; i++)
+    spread += sampler.trial(graph, {}, {0}, all);
+  REQUIRE(n_live == spread - 100);  // One live edge per new node
+  REQUIRE(n_trials > n_live);
+  std::unordered_set<unode_int> reached;
+  auto live_only = make_trial_sink(
+      [&](unode_int source, unode_int target, unsigned int live) {
+        n_failures += 1 - live;
+        if (source == 3)
+          reached.insert(target);
+      }, false);
+  graph.use_constant_influence(1.0);
+  REQUIRE(sampler.trial(graph, {}, {3}, live_only) == 8);
+  REQUIRE(n_failures == 0);
+  REQUIRE(reached.size() > 0);
+}
+
+// Test the live edges drawn for 64 worlds at once, and the bit-parallel
+// cascades of SpreadSampler against cascades simulated one by one
+TEST_CASE( "BIT-PARALLEL SAMPLER", "[bit-parallel sampler]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.use_constant_influence(0.3);
+  const EdgeParameters& params = graph.get_edge_parameters();
+  Xorshift rng(42);
+  double live = 0, live_few = 0;
+  for (int i = 0; i < 10000; i++) {
+    live += __builtin_popcountll(params.live_mask(0, 1, 0, ~0ULL, rng));
+    live_few += __builtin_popcountll(params.live_mask(0, 1, 0, 0xF0, rng));
+  }
+  REQUIRE(live / 640000 == Approx(0.3).margin(0.005));
+  REQUIRE(live_few / 40000 == Approx(0.3).margin(0.01));
+  REQUIRE(params.live_mask(0, 1, 0, 0, rng) == 0);
+  SpreadSampler sampler(INFLUENCE_MED, 1);
+  double expected = 0;
+  for (int i = 0; i < 20000; i++)
+    expected += sampler.perform_diffusion(graph, {0}).size() - 1;
+  REQUIRE(sampler.sample(graph, {0}, {0}, 20000)
+          == Approx(expected / 20000).epsilon(0.05));
+  graph.use_weighted_cascade();
+  expected = 0;
+  for (int i = 0; i < 20000; i++)
+    expected += sampler.perform_diffusion(graph, {2, 5}).size();
+  REQUIRE(sampler.sample(graph, {}, {2, 5}, 20000)
+          == Approx(expected / 20000).epsilon(0.05));
+}
+
+// Test the batched generator and the live edges drawn by blocks from it
+TEST_CASE( "BATCHED RANDOM", "[batched random]" ) {
+  Xoshiro rng(42);
+  double sum = 0;
+  uint64_t ones = 0;
+  for (int i = 0; i < 100000; i++) {
+    sum += rng.gen_double();
+    ones += __builtin_popcountll(rng.gen_uint64());
+  }
+  REQUIRE(sum / 100000 == Approx(0.5).margin(0.005));
+  REQUIRE(ones / 6400000. == Approx(0.5).margin(0.001));
+  Graph graph;
+  for (unode_int leaf = 1; leaf <= 100; leaf++)
+    graph.add_edge(0, leaf, 0.2);
+  graph.freeze();
+  const EdgeParameters& params = graph.get_edge_parameters();
+  EdgeRange edges = graph.get_neighbours(0);
+  REQUIRE(edges.data() != nullptr);
+  double live = 0;
+  for (int i = 0; i < 10000; i++)
+    live += __builtin_popcountll(
+        params.live_edges(edges.data(), 64, false, INFLUENCE_MED, rng));
+  REQUIRE(live / 640000 == Approx(0.2).margin(0.005));
+  std::vector<int> counts(101, 0);
+  for (int i = 0; i < 10000; i++)
+    graph.draw_live_edges(0, INFLUENCE_MED, rng, [&](const EdgeType& edge) {
+      counts[edge.target]++;
+    });
+  REQUIRE(counts[0] == 0);
+  REQUIRE(*std::min_element(counts.begin() + 1, counts.end()) > 1700);
+  REQUIRE(*std::max_element(counts.begin() + 1, counts.end()) < 2300);
+}
+
+// Test the Philox streams (known answers of the Random123 library) and the
+// reproducibility of runs given a seed
+TEST_CASE( "RANDOM STREAMS", "[random streams]" ) {
+  uint32_t block[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+  philox_block(block, 0xa4093822, 0x299f31d0);
+  REQUIRE(block[0] == 0xd16cfe09);
+  REQUIRE(block[3] == 0x24126ea1);
+  Philox stream(STREAM_SAMPLES, 7, 42), same(STREAM_SAMPLES, 7, 42);
+  Philox other(STREAM_SAMPLES, 8, 42);
+  int same_values = 0, other_values = 0;
+  for (int i = 0; i < 100; i++) {
+    int value = stream.gen_int();
+    same_values += (value == same.gen_int());
+    other_values += (value == other.gen_int());
+  }
+  REQUIRE(same_values == 100);
+  REQUIRE(other_values == 0);
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.use_constant_influence(0.3);
+  std::vector<double> spreads;
+  for (int run = 0; run < 2; run++) {
+    RunSeed::get_instance().set(42);
+    SpreadSampler sampler(INFLUENCE_MED, 1);
+    spreads.push_back(sampler.sample(graph, {}, {0, 3}, 1000));
+  }
+  REQUIRE(spreads[0] == spreads[1]);
+}
+
+// Test that the spreads estimated on several threads are the ones estimated
+// on a single thread
+TEST_CASE( "THREADED SAMPLER", "[threaded sampler]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.use_constant_influence(0.3);
+  std::vector<double> spreads;
+  for (unsigned int n_threads : {1, 3, 8}) {
+    RunSeed::get_instance().set(7);
+    SpreadSampler sampler(INFLUENCE_MED, 1, n_threads);
+    spreads.push_back(sampler.sample(graph, {}, {0, 3}, 1000));
+  }
+  REQUIRE(spreads[0] == spreads[1]);
+  REQUIRE(spreads[0] == spreads[2]);
+  SpreadSampler sampler(INFLUENCE_MED, 1, 4);
+  double expected = 0;
+  for (int i = 0; i < 20000; i++)
+    expected += sampler.perform_diffusion(graph, {0, 3}).size();
+  REQUIRE(spreads[0] == Approx(expected / 20000).epsilon(0.05));
+}
+
+// Test that adaptive sampling stops once the relative error is reached, with
+// an estimate close to the one of the full budget
+TEST_CASE( "ADAPTIVE SAMPLING", "[adaptive sampling]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.use_constant_influence(0.3);
+  SpreadSampler sampler(INFLUENCE_MED, 1);
+  double full = sampler.sample(graph, {}, {0, 3}, 100000);
+  double spread = sampler.sample_adaptive(graph, {}, {0, 3}, 100000, 0.02,
+                                          0.95);
+  unode_int used = sampler.get_used_samples();
+  REQUIRE(used < 100000);
+  REQUIRE(used % SAMPLE_GROUP == 0);
+  REQUIRE(spread == Approx(full).epsilon(0.05));
+  sampler.sample_adaptive(graph, {}, {0, 3}, 1000, 1e-6, 0.95);
+  REQUIRE(sampler.get_used_samples() == 1000);
+}
+
+// Test the live edges of hubs drawn by geometric jumps, forward and reversed,
+// on plain and compressed lists
+TEST_CASE( "GEOMETRIC SKIPS", "[geometric skips]" ) {
+  Graph graph;
+  for (unode_int leaf = 1; leaf <= 1000; leaf++) {
+    graph.add_edge(0, leaf, 1.0);
+    graph.add_edge(leaf, 1001, 1.0);
+  }
+  graph.freeze();
+  for (bool compressed : {false, true}) {
+    if (compressed)
+      graph.compress();
+    graph.use_constant_influence(0.01);
+    SpreadSampler sampler(INFLUENCE_MED, 1);
+    double spread = 0;
+    for (int i = 0; i < 20000; i++)
+      spread += sampler.perform_diffusion(graph, {0}).size() - 1;
+    // Each of the 1000 leaves is reached with probability 0.01, and the sink
+    // with probability 0.01 per reached leaf
+    double leaves = 1000 * 0.01;
+    double sink = 1 - pow(1 - 0.01 * 0.01, 1000);
+    REQUIRE(spread / 20000 == Approx(leaves + sink).epsilon(0.02));
+    // RR sets of the sink under the weighted cascade: one leaf on average
+    graph.use_weighted_cascade();
+    RRSets rr_sets;
+    for (int i = 0; i < 20000; i++)
+      sampler.perform_unique_sample(graph, 1001, rr_sets, true);
+    double rr_size = rr_sets.get_number_nodes() - 20000.0;
+    double root = 1 - pow(1 - 1. / 1000, 1000);  // Some leaf reaches the root
+    REQUIRE(rr_size / 20000 == Approx(1 + root).epsilon(0.03));
+  }
+}
+
+// Test the flat list of RR sets, and the RR sets appended to it by the sampler
+TEST_CASE( "RR SETS", "[rr sets]" ) {
+  RRSets rr_sets;
+  std::vector<unode_int> nodes = {4, 2, 7};
+  rr_sets.add(nodes.begin(), nodes.end());
+  rr_sets.push_node(5);
+  rr_sets.close_set();
+  rr_sets.close_set();  // Empty set
+  REQUIRE(rr_sets.size() == 3);
+  REQUIRE(rr_sets.get_number_nodes() == 4);
+  REQUIRE(rr_sets[0].size() == 3);
+  REQUIRE(rr_sets[0][2] == 7);
+  REQUIRE(rr_sets[1][0] == 5);
+  REQUIRE(rr_sets[2].size() == 0);
+  // A set crossing the end of a block is moved whole to the next one, and
+  // the previous sets stay in place
+  const unode_int* first = rr_sets[0].begin();
+  std::vector<unode_int> large(RR_BLOCK_NODES - 6, 3);
+  rr_sets.add(large.begin(), large.end());
+  rr_sets.add(nodes.begin(), nodes.end());
+  REQUIRE(rr_sets[0].begin() == first);
+  REQUIRE(rr_sets[3].size() == RR_BLOCK_NODES - 6);
+  REQUIRE(rr_sets[3].end() - rr_sets[4].begin() != 0);
+  REQUIRE(rr_sets[4][1] == 2);
+  REQUIRE(rr_sets.get_number_nodes() == RR_BLOCK_NODES + 1);
+  rr_sets.clear();
+  REQUIRE(rr_sets.empty() == true);
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.use_constant_influence(1.0);  // RR sets hold all the ancestors
+  SpreadSampler sampler(INFLUENCE_MED, 1);
+  REQUIRE(sampler.perform_unique_sample(graph, 7, rr_sets, true) == 8);
+  REQUIRE(sampler.perform_unique_sample(graph, 0, rr_sets) == 8);
+  REQUIRE(rr_sets.size() == 2);
+  REQUIRE(rr_sets[0][0] == 7);
+  REQUIRE(rr_sets[1][0] == 0);
+  std::unordered_set<unode_int> reached(rr_sets[1].begin(), rr_sets[1].end());
+  REQUIRE(reached.size() == 8);
+}
+
+// Test that snapshots are drawn again only when the graph changes, and that
+// PMC and CELF (StaticGreedy) share them
+TEST_CASE( "SNAPSHOT STORE", "[snapshot store]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.use_constant_influence(0.3);
+  RunSeed::get_instance().set(7);
+  SnapshotStore store(2000, 0.05, 3);
+  store.get(graph, INFLUENCE_MED);
+  double live = 0;
+  for (unsigned int t = 0; t < store.size(); t++)
+    store.for_each_live_edge(graph, INFLUENCE_MED, t,
+                             [&](unode_int, unode_int) { live++; });
+  REQUIRE(live / (2000 * 14) == Approx(0.3).epsilon(0.05));
+  RunSeed::get_instance().set(7);
+  SnapshotStore single_store(2000, 0.05, 1);
+  single_store.get(graph, INFLUENCE_MED);
+  double spread = store.spread(graph, INFLUENCE_MED, {1}, {0, 3});
+  REQUIRE(single_store.spread(graph, INFLUENCE_MED, {1}, {0, 3}) == spread);
+  SpreadSampler sampler(INFLUENCE_MED, 1);
+  REQUIRE(spread == Approx(sampler.sample(graph, {1}, {0, 3}, 20000))
+                        .epsilon(0.05));
+  graph.use_constant_influence(0.305);  // Within the tolerance
+  store.get(graph, INFLUENCE_MED);
+  REQUIRE(store.get_draws() == 1);
+  graph.use_constant_influence(0.32);
+  store.get(graph, INFLUENCE_MED);
+  REQUIRE(store.get_draws() == 2);
+  auto snapshots = std::make_shared<SnapshotStore>(200);
+  PMCEvaluator pmc(snapshots);
+  CELFEvaluator celf(snapshots);
+  std::unordered_set<unode_int> pmc_seeds = pmc.select(graph, sampler, {}, 3);
+  REQUIRE(pmc.select(graph, sampler, {}, 3) == pmc_seeds);
+  REQUIRE(celf.select(graph, sampler, {}, 3).size() == 3);
+  REQUIRE(snapshots->get_draws() == 1);
+  // Posteriors of mean 0.001: one hit doubles the influence of an edge, which
+  // moves by less than 0.01 but needs new snapshots
+  Graph original_graph, model_graph;
+  load_model_and_original_graph("datasets/graph_test.csv", 1, 999,
+                                original_graph, model_graph);
+  SnapshotStore model_store(200);
+  model_store.get(model_graph, INFLUENCE_MED);
+  model_graph.update_edge(0, 1, 0);  // 0.001 to 0.000999
+  model_store.get(model_graph, INFLUENCE_MED);
+  REQUIRE(model_store.get_draws() == 1);
+  model_graph.update_edge(0, 1, 1);
+  model_store.get(model_graph, INFLUENCE_MED);
+  REQUIRE(model_store.get_draws() == 2);
+  // Influences drawn from the posteriors do not depend on the threads either
+  Graph thompson_graph;
+  load_model_and_original_graph("datasets/graph_test.csv", 1, 1,
+                                original_graph, thompson_graph);
+  std::vector<std::vector<std::pair<unode_int, unode_int>>> thompson(2);
+  for (unsigned int n_threads : {1, 3}) {
+    RunSeed::get_instance().set(7);
+    SnapshotStore thompson_store(200, 0.05, n_threads);
+    thompson_store.get(thompson_graph, INFLUENCE_THOMPSON);
+    for (unsigned int t = 0; t < thompson_store.size(); t++)
+      thompson_store.for_each_live_edge(thompson_graph, INFLUENCE_THOMPSON, t,
+          [&](unode_int source, unode_int target) {
+        thompson[n_threads / 2].push_back({source, target});
+      });
+  }
+  REQUIRE(thompson[0].size() > 0);
+  REQUIRE(thompson[0] == thompson[1]);
+}
+
+// Test that a graph saved in the binary format is loaded identically
+TEST_CASE( "BINARY GRAPH", "[binary graph]" ) {
+  Graph graph, binary_graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  graph.save_binary("datasets/graph_test.bin");
+  unsigned long n_edges = load_original_graph("datasets/graph_test.bin",
+                                              binary_graph);
+  REQUIRE(n_edges == 14);
+  REQUIRE(binary_graph.get_number_nodes() == 8);
+  REQUIRE(binary_graph.is_frozen() == true);
+  for (auto u : graph.get_nodes()) {
+    REQUIRE(binary_graph.has_node(u) == true);
+    auto edges = graph.get_neighbours(u);
+    auto binary_edges = binary_graph.get_neighbours(u);
+    REQUIRE(binary_edges.size() == edges.size());
+    for (size_t i = 0; i < edges.size(); i++) {
+      REQUIRE(binary_edges[i].target == edges[i].target);
+      REQUIRE(binary_graph.get_influence(binary_edges[i], INFLUENCE_MED)
+              == graph.get_influence(edges[i], INFLUENCE_MED));
+    }
+    REQUIRE(binary_graph.get_neighbours(u, true).size()
+            == graph.get_neighbours(u, true).size());
+  }
+  // Modifying a loaded graph leaves the file untouched
+  binary_graph.remove_node(3);
+  REQUIRE(binary_graph.get_number_nodes() == 7);
+  Graph original_graph, model_graph;
+  load_model_and_original_graph("datasets/graph_test.bin", 1, 1,
+                                original_graph, model_graph);
+  REQUIRE(original_graph.get_number_edges() == 14);
+  auto edge = model_graph.get_neighbours(0)[0];
+  REQUIRE(model_graph.get_influence(edge, INFLUENCE_MED) == Approx(0.5));
+  model_graph.update_edge(0, 1, 1);
+  REQUIRE(model_graph.get_edge_parameters().mean(edge.id, 1)
+          == Approx(2. / 3));
+  std::remove("datasets/graph_test.bin");
+}
+
+// Test the symmetric layout of undirected graphs, saved in binary and converted
+// to the directed layout when modified
+TEST_CASE( "UNDIRECTED GRAPH", "[undirected graph]" ) {
+  EdgeList edges;
+  edges.sources = {0, 1, 2, 1, 2};
+  edges.targets = {1, 0, 1, 3, 2};
+  edges.probs = {0.1, 0.9, 0.2, 0.3, 0.4};
+  Graph graph, binary_graph;
+  graph.assign_undirected_edges(edges);
+  graph.save_binary("datasets/graph_test.bin");
+  binary_graph.load_binary("datasets/graph_test.bin");
+  for (Graph* g : {&graph, &binary_graph}) {
+    REQUIRE(g->is_symmetric() == true);
+    REQUIRE(g->get_number_nodes() == 4);
+    REQUIRE(g->get_number_edges() == 7);  // The self loop is a single edge
+    REQUIRE(g->get_edge_parameters().size() == 4);
+    std::vector<unode_int> targets;
+    for (auto& edge : g->get_neighbours(1))
+      targets.push_back(edge.target);
+    REQUIRE(targets == std::vector<unode_int>({0, 2, 3}));
+    REQUIRE(g->get_neighbours(1, true).size() == 3);
+    REQUIRE(g->get_influence(g->get_neighbours(1)[0], INFLUENCE_MED)
+            == Approx(0.1));
+    REQUIRE(g->find_edge(1, 2) == g->find_edge(2, 1));
+    REQUIRE(g->get_neighbours(2, true)[1].target == 2);
+  }
+  std::remove("datasets/graph_test.bin");
+  graph.add_edge(0, 3, 0.5);
+  REQUIRE(graph.is_symmetric() == false);
+  REQUIRE(graph.get_number_edges() == 8);
+  REQUIRE(graph.get_edge_parameters().size() == 8);
+  REQUIRE(graph.get_neighbours(3, true).size() == 2);
+  REQUIRE(graph.get_neighbours(0).size() == 2);
+  REQUIRE(graph.get_influence(graph.get_neighbours(2)[0], INFLUENCE_MED)
+          == Approx(0.2));
+}
+
 // Test the removal of a node in the graph (and checks we also delete the
 // desired edges
 TEST_CASE( "REMOVE NODE", "[remove node]" ) {
@@ -51,12 +836,43 @@ TEST_CASE( "REMOVE NODE", "[remove node]" ) {
   REQUIRE(copy_graph.get_neighbours(6, true).size() == 2);
 }
 
+// Test that removing a node from a view matches removing it from a copy
+TEST_CASE( "GRAPH VIEW", "[graph view]" ) {
+  Graph graph;
+  load_original_graph("datasets/graph_test.csv", graph);
+  GraphView view(graph);
+  view.remove_node(3);
+  REQUIRE(graph.get_number_nodes() == 8);
+  REQUIRE(graph.get_number_edges() == 14);
+  REQUIRE(view.get_number_nodes() == 7);
+  REQUIRE(view.get_number_edges() == 10);
+  REQUIRE(view.has_node(3) == false);
+  REQUIRE(view.has_neighbours(3) == false);
+  REQUIRE(view.get_degree(2) == 3);
+  REQUIRE(view.get_degree(2, true) == 1);
+  REQUIRE(view.get_degree(4, true) == 1);
+  REQUIRE(view.get_degree(6) == 1);
+  REQUIRE(view.get_degree(6, true) == 2);
+  unsigned int n_neighbours = 0;
+  for (auto& edge : view.get_neighbours(2)) {
+    REQUIRE(edge.target != 3);
+    n_neighbours++;
+  }
+  REQUIRE(n_neighbours == 3);
+  unsigned int n_nodes = 0;
+  for (auto node : view.get_nodes()) {
+    REQUIRE(node != 3);
+    n_nodes++;
+  }
+  REQUIRE(n_nodes == 7);
+}
+
 // Test that the reduction with greedy algorithm works
 TEST_CASE( "GREEDY MAX COVERING REDUCTION", "[greedy max cover]" ) {
   Graph graph;
   load_original_graph("datasets/graph_test.csv", graph);
   GreedyMaxCoveringReduction g_reduction = GreedyMaxCoveringReduction();
-  std::vector<unsigned long> experts = g_reduction.extractExperts(graph, 1);
+  std::vector<unode_int> experts = g_reduction.extractExperts(graph, 1);
   REQUIRE(experts.size() == 1);
   REQUIRE(experts[0] == 2);
   experts = g_reduction.extractExperts(graph, 2);